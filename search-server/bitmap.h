@@ -0,0 +1,75 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+// Bit set over document ordinals
+class Bitmap {
+public:
+    Bitmap() = default;
+
+    explicit Bitmap(size_t size)
+        : words_((size + 63) / 64, 0), size_(size) {
+    }
+
+    // New bits are cleared
+    void Resize(size_t size) {
+        words_.resize((size + 63) / 64, 0);
+        size_ = size;
+    }
+
+    // Sets every bit below size()
+    void SetAll() {
+        fill(words_.begin(), words_.end(), ~uint64_t{0});
+        if (size_ % 64 != 0) {
+            words_.back() = (uint64_t{1} << (size_ % 64)) - 1;
+        }
+    }
+
+    void Set(size_t pos) {
+        words_[pos >> 6] |= uint64_t{1} << (pos & 63);
+    }
+
+    void Reset(size_t pos) {
+        words_[pos >> 6] &= ~(uint64_t{1} << (pos & 63));
+    }
+
+    bool Test(size_t pos) const {
+        return (words_[pos >> 6] >> (pos & 63)) & 1;
+    }
+
+    // First set bit not less than pos, size() if there is none
+    size_t FindNext(size_t pos) const {
+        if (pos >= size_) {
+            return size_;
+        }
+        size_t index = pos >> 6;
+        uint64_t word = words_[index] & (~uint64_t{0} << (pos & 63));
+        while (word == 0) {
+            if (++index == words_.size()) {
+                return size_;
+            }
+            word = words_[index];
+        }
+        return min((index << 6) + __builtin_ctzll(word), size_);
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    size_t Count() const {
+        size_t count = 0;
+        for (uint64_t word : words_) {
+            count += __builtin_popcountll(word);
+        }
+        return count;
+    }
+
+private:
+    vector<uint64_t> words_;
+    size_t size_ = 0;
+};
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include "compressed_posting_list.h"
+
+using namespace std;
+
+namespace {
+
+unsigned GetBitWidth(uint32_t value) {
+    return value == 0 ? 0 : 32 - __builtin_clz(value);
+}
+
+void WriteBits(vector<uint64_t>& words, size_t bit, uint32_t value, unsigned width) {
+    if (width == 0) {
+        return;
+    }
+    const size_t shift = bit & 63;
+    words[bit >> 6] |= static_cast<uint64_t>(value) << shift;
+    if (shift + width > 64) {
+        words[(bit >> 6) + 1] |= static_cast<uint64_t>(value) >> (64 - shift);
+    }
+}
+
+} // namespace
+
+CompressedPostingList::CompressedPostingList(const PostingList& postings) {
+    for (const Posting& posting : postings) {
+        Append(posting.ordinal, posting.term_freq);
+    }
+    Flush();
+}
+
+void CompressedPostingList::Append(uint32_t ordinal, double term_freq) {
+    tail_.push_back({ordinal, term_freq});
+    ++size_;
+    if (tail_.size() == BLOCK_SIZE) {
+        PackTail();
+    }
+}
+
+void CompressedPostingList::Flush() {
+    if (!tail_.empty()) {
+        PackTail();
+    }
+    tail_.shrink_to_fit();
+    blocks_.shrink_to_fit();
+    bits_.shrink_to_fit();
+    term_freqs_.shrink_to_fit();
+    vector<uint32_t>().swap(codes_by_freq_);
+}
+
+uint32_t CompressedPostingList::GetCode(double term_freq) {
+    if (codes_by_freq_.size() != term_freqs_.size()) {
+        // Appending after Flush
+        codes_by_freq_.resize(term_freqs_.size());
+        iota(codes_by_freq_.begin(), codes_by_freq_.end(), 0);
+        sort(codes_by_freq_.begin(), codes_by_freq_.end(), [this](uint32_t lhs, uint32_t rhs) {
+            return term_freqs_[lhs] < term_freqs_[rhs];
+        });
+    }
+    auto it = lower_bound(codes_by_freq_.begin(), codes_by_freq_.end(), term_freq,
+                          [this](uint32_t code, double value) {
+                              return term_freqs_[code] < value;
+                          });
+    if (it != codes_by_freq_.end() && term_freqs_[*it] == term_freq) {
+        return *it;
+    }
+    const uint32_t code = static_cast<uint32_t>(term_freqs_.size());
+    term_freqs_.push_back(term_freq);
+    codes_by_freq_.insert(it, code);
+    return code;
+}
+
+void CompressedPostingList::PackTail() {
+    vector<uint32_t> codes(tail_.size());
+    uint32_t max_delta = 0;
+    uint32_t max_code = 0;
+    for (size_t i = 0; i < tail_.size(); ++i) {
+        if (i != 0) {
+            max_delta = max(max_delta, tail_[i].ordinal - tail_[i - 1].ordinal);
+        }
+        codes[i] = GetCode(tail_[i].term_freq);
+        max_code = max(max_code, codes[i]);
+    }
+
+    Block block;
+    block.first_ordinal = tail_.front().ordinal;
+    block.last_ordinal = tail_.back().ordinal;
+    block.offset = static_cast<uint32_t>(bits_.size());
+    block.count = static_cast<uint16_t>(tail_.size());
+    block.delta_bits = static_cast<uint8_t>(GetBitWidth(max_delta));
+    block.code_bits = static_cast<uint8_t>(GetBitWidth(max_code));
+
+    // Deltas go first, the first one is always zero and is kept only to simplify decoding
+    const size_t bit_count = tail_.size() * (block.delta_bits + block.code_bits);
+    bits_.resize(bits_.size() + (bit_count + 63) / 64, 0);
+    size_t bit = static_cast<size_t>(block.offset) * 64;
+    for (size_t i = 0; i < tail_.size(); ++i, bit += block.delta_bits) {
+        WriteBits(bits_, bit, i == 0 ? 0 : tail_[i].ordinal - tail_[i - 1].ordinal, block.delta_bits);
+    }
+    for (size_t i = 0; i < tail_.size(); ++i, bit += block.code_bits) {
+        WriteBits(bits_, bit, codes[i], block.code_bits);
+    }
+    blocks_.push_back(block);
+    tail_.clear();
+}
+
+void CompressedPostingList::Renumber(const vector<uint32_t>& new_ordinals) {
+    // Deltas change with the ordinals, so the list is encoded anew
+    vector<Posting> postings(begin(), end());
+    *this = CompressedPostingList();
+    for (const Posting& posting : postings) {
+        Append(new_ordinals[posting.ordinal], posting.term_freq);
+    }
+    Flush();
+}
+
+bool CompressedPostingList::Contains(uint32_t ordinal) const {
+    auto it = LowerBound(ordinal);
+    return it != end() && it->ordinal == ordinal;
+}
+
+CompressedPostingList::const_iterator CompressedPostingList::LowerBound(uint32_t ordinal) const {
+    return LowerBound(begin(), ordinal);
+}
+
+CompressedPostingList::const_iterator CompressedPostingList::LowerBound(const_iterator first, uint32_t ordinal) const {
+    if (first.block_ == blocks_.size() || blocks_[first.block_].last_ordinal >= ordinal) {
+        // The block of first or the tail holds the result
+        const const_iterator last = end();
+        while (first != last && first->ordinal < ordinal) {
+            ++first;
+        }
+        return first;
+    }
+    size_t low = first.block_;
+    size_t step = 1;
+    while (low + step < blocks_.size() && blocks_[low + step].last_ordinal < ordinal) {
+        low += step;
+        step *= 2;
+    }
+    auto block = partition_point(blocks_.begin() + low + 1, blocks_.begin() + min(low + step, blocks_.size()),
+                                 [ordinal](const Block& block) {
+                                     return block.last_ordinal < ordinal;
+                                 });
+    if (block == blocks_.end()) {
+        auto it = lower_bound(tail_.begin(), tail_.end(), ordinal, [](const Posting& lhs, uint32_t value) {
+            return lhs.ordinal < value;
+        });
+        const_iterator result = end();
+        result.position_ = it - tail_.begin();
+        result.Load();
+        return result;
+    }
+    // The block holds an ordinal not less than the given one, so the scan stops inside it
+    const_iterator result(this, block - blocks_.begin());
+    while (result->ordinal < ordinal) {
+        ++result;
+    }
+    return result;
+}
+
+CompressedPostingList::const_iterator CompressedPostingList::begin() const {
+    return const_iterator(this, 0);
+}
+
+CompressedPostingList::const_iterator CompressedPostingList::end() const {
+    const_iterator result(this, blocks_.size());
+    result.position_ = tail_.size();
+    return result;
+}
+
+size_t CompressedPostingList::size() const {
+    return size_;
+}
+
+bool CompressedPostingList::empty() const {
+    return size_ == 0;
+}
+
+size_t CompressedPostingList::GetByteSize() const {
+    return blocks_.capacity() * sizeof(Block) + bits_.capacity() * sizeof(uint64_t)
+           + term_freqs_.capacity() * sizeof(double) + codes_by_freq_.capacity() * sizeof(uint32_t)
+           + tail_.capacity() * sizeof(Posting);
+}
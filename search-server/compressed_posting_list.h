@@ -0,0 +1,188 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+#include "posting_list.h"
+
+using namespace std;
+
+// Posting list packed into blocks of up to BLOCK_SIZE postings. A block stores ordinal deltas and
+// indexes into the list's table of distinct term frequencies, both bit-packed with the block's own
+// widths, so term frequencies are restored exactly. Blocks keep their first and last ordinals as skip data.
+// Postings may only be appended in ascending ordinal order, they are packed once a block fills up.
+class CompressedPostingList {
+public:
+    static const size_t BLOCK_SIZE = 128;
+
+    class const_iterator {
+    public:
+        using iterator_category = forward_iterator_tag;
+        using value_type = Posting;
+        using difference_type = ptrdiff_t;
+        using pointer = const Posting*;
+        using reference = const Posting&;
+
+        reference operator*() const {
+            return current_;
+        }
+
+        pointer operator->() const {
+            return &current_;
+        }
+
+        const_iterator& operator++() {
+            ++position_;
+            Load();
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            auto prev = *this;
+            ++*this;
+            return prev;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return block_ == other.block_ && position_ == other.position_;
+        }
+
+        bool operator!=(const const_iterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        friend class CompressedPostingList;
+
+        // Starts at the first posting of the block
+        const_iterator(const CompressedPostingList* list, size_t block);
+
+        // Decodes the posting at position_, moving to the next block when the current one is over
+        void Load();
+
+        const CompressedPostingList* list_ = nullptr;
+        size_t block_ = 0;
+        size_t position_ = 0;
+        size_t delta_bit_ = 0;
+        size_t code_bit_ = 0;
+        Posting current_{0, 0.0};
+    };
+
+    CompressedPostingList() = default;
+    explicit CompressedPostingList(const PostingList& postings);
+
+    // The ordinal must be greater than every ordinal in the list
+    void Append(uint32_t ordinal, double term_freq);
+
+    // Packs appended postings that do not fill a block yet
+    void Flush();
+
+    // Erases postings whose ordinal matches the predicate and repacks the list, returns the number erased
+    template <typename Predicate>
+    size_t RemoveIf(Predicate predicate);
+
+    // Replaces every ordinal with new_ordinals[ordinal] and repacks the list,
+    // the mapping must keep the order of the list
+    void Renumber(const vector<uint32_t>& new_ordinals);
+
+    bool Contains(uint32_t ordinal) const;
+
+    // First posting with ordinal not less than the given one, blocks before it are skipped undecoded
+    const_iterator LowerBound(uint32_t ordinal) const;
+    // Same, galloping over the blocks from the one of first, so short skips stay in it
+    const_iterator LowerBound(const_iterator first, uint32_t ordinal) const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    size_t size() const;
+    bool empty() const;
+
+    // Heap memory held by the list
+    size_t GetByteSize() const;
+
+private:
+    struct Block {
+        uint32_t first_ordinal;
+        uint32_t last_ordinal;
+        uint32_t offset; // In words of bits_
+        uint16_t count;
+        uint8_t delta_bits;
+        uint8_t code_bits;
+    };
+
+    vector<Block> blocks_;
+    vector<uint64_t> bits_;
+    vector<double> term_freqs_; // Distinct term frequencies, indexed by codes
+    vector<uint32_t> codes_by_freq_; // Codes sorted by term frequency while appending, dropped by Flush
+    vector<Posting> tail_;      // Appended postings waiting for a full block
+    size_t size_ = 0;
+
+    static uint32_t ReadBits(const uint64_t* words, size_t bit, unsigned width) {
+        if (width == 0) {
+            return 0;
+        }
+        const size_t shift = bit & 63;
+        uint64_t value = words[bit >> 6] >> shift;
+        if (shift + width > 64) {
+            value |= words[(bit >> 6) + 1] << (64 - shift);
+        }
+        return static_cast<uint32_t>(value & ((uint64_t{1} << width) - 1));
+    }
+
+    // Binary search over codes_by_freq_, new frequencies get the next code
+    uint32_t GetCode(double term_freq);
+    void PackTail();
+};
+
+inline CompressedPostingList::const_iterator::const_iterator(const CompressedPostingList* list, size_t block)
+    : list_(list), block_(block) {
+    Load();
+}
+
+inline void CompressedPostingList::const_iterator::Load() {
+    while (block_ < list_->blocks_.size()) {
+        const Block& block = list_->blocks_[block_];
+        if (position_ == block.count) {
+            ++block_;
+            position_ = 0;
+            continue;
+        }
+        const uint64_t* words = list_->bits_.data();
+        if (position_ == 0) {
+            delta_bit_ = static_cast<size_t>(block.offset) * 64;
+            code_bit_ = delta_bit_ + static_cast<size_t>(block.count) * block.delta_bits;
+            current_.ordinal = block.first_ordinal;
+        } else {
+            delta_bit_ += block.delta_bits;
+            code_bit_ += block.code_bits;
+            current_.ordinal += ReadBits(words, delta_bit_, block.delta_bits);
+        }
+        current_.term_freq = list_->term_freqs_[ReadBits(words, code_bit_, block.code_bits)];
+        return;
+    }
+    if (position_ < list_->tail_.size()) {
+        current_ = list_->tail_[position_];
+    }
+}
+
+template <typename Predicate>
+size_t CompressedPostingList::RemoveIf(Predicate predicate) {
+    vector<Posting> postings;
+    postings.reserve(size_);
+    for (const Posting& posting : *this) {
+        if (!predicate(posting.ordinal)) {
+            postings.push_back(posting);
+        }
+    }
+    const size_t erased_count = size_ - postings.size();
+    if (erased_count != 0) {
+        *this = CompressedPostingList();
+        for (const Posting& posting : postings) {
+            Append(posting.ordinal, posting.term_freq);
+        }
+        Flush();
+    }
+    return erased_count;
+}
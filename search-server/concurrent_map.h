@@ -1,15 +1,13 @@
+#pragma once
 #include <mutex>
 #include <algorithm>
-#include <cstdlib>
-#include <future>
+#include <cstdint>
 #include <map>
-#include <numeric>
 #include <string>
-#include <atomic>
-#include <execution>
-
-#include "log_duration.h"
-#include "test_framework.h"
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 using namespace std::string_literals;
 
@@ -18,61 +16,88 @@ class ConcurrentMap {
 public:
     static_assert(std::is_integral_v<Key>, "ConcurrentMap supports only integer keys"s);
 
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+    static constexpr size_t BUCKETS_PER_CORE = 4;
+
+private:
+    // Every bucket takes whole cache lines, so neighbouring mutexes are not falsely shared
+    struct alignas(CACHE_LINE_SIZE) Bucket {
+        std::mutex mutex;
+        std::map<Key, Value> map;
+    };
+
+public:
     struct Access {
-        
-        Access(std::mutex& mut, Value& ref) 
-            : guard(mut), ref_to_value(ref)
+        Access(const Key& key, Bucket& bucket)
+            : guard(bucket.mutex), ref_to_value(bucket.map[key])
         {
         }
 
-        ~Access() {
-            guard.unlock();
-        }
-        
-        std::mutex& guard;
+        std::lock_guard<std::mutex> guard;
         Value& ref_to_value;
     };
 
-    explicit ConcurrentMap(size_t bucket_count) 
-        : BUCKET_COUNT(bucket_count), part_mutex_(bucket_count), divided_map_(bucket_count)
+    // Bucket count scales with the number of available cores
+    ConcurrentMap()
+        : ConcurrentMap(std::max(1u, std::thread::hardware_concurrency()) * BUCKETS_PER_CORE)
+    {
+    }
+
+    explicit ConcurrentMap(size_t bucket_count)
+        : buckets_(std::max<size_t>(bucket_count, 1))
     {
     }
 
     Access operator[](const Key& key) {
-    
-        for (int i = 0; i < static_cast<int>(divided_map_.size()); ++i) {
-            
-            if (divided_map_[i].count(key) != 0) {
-                part_mutex_[i].lock();
-                return {part_mutex_[i], divided_map_[i].at(key)};
-            }
-        }
-        uint64_t mutex_num = next_insertion_.fetch_add(1) % BUCKET_COUNT;
-        part_mutex_[mutex_num].lock();
-        return {part_mutex_[mutex_num], divided_map_[mutex_num][key]};
+        return {key, GetBucket(key)};
     }
-    
+
     void erase(const Key& key) {
-        for (int i = 0; i < static_cast<int>(divided_map_.size()); ++i) {
-            if (divided_map_[i].count(key) != 0) {
-                std::lock_guard guard(part_mutex_[i]);
-                divided_map_[i].erase(key);
-            }
-        }
+        Bucket& bucket = GetBucket(key);
+        std::lock_guard guard(bucket.mutex);
+        bucket.map.erase(key);
     }
 
+    // Moves the nodes out of the buckets, as std::map::merge does
     std::map<Key, Value> BuildOrdinaryMap() {
         std::map<Key, Value> ordinary_map;
-        for (int i = 0; i < static_cast<int>(divided_map_.size()); ++i) {
-            std::lock_guard guard(part_mutex_[i]);
-            ordinary_map.merge(divided_map_[i]);
+        for (Bucket& bucket : buckets_) {
+            std::lock_guard guard(bucket.mutex);
+            ordinary_map.merge(bucket.map);
         }
         return ordinary_map;
     }
 
+    // Copy of the content in a key-sorted vector, merged from the already sorted buckets.
+    // Unlike BuildOrdinaryMap, the map keeps its content
+    std::vector<std::pair<Key, Value>> BuildSortedVector() {
+        std::vector<std::pair<Key, Value>> result;
+        std::vector<size_t> bounds = {0};
+        for (Bucket& bucket : buckets_) {
+            std::lock_guard guard(bucket.mutex);
+            result.insert(result.end(), bucket.map.begin(), bucket.map.end());
+            bounds.push_back(result.size());
+        }
+        auto by_key = [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; };
+        // Bottom-up merge of adjacent sorted runs
+        for (size_t step = 1; step + 1 < bounds.size(); step *= 2) {
+            for (size_t i = 0; i + step + 1 < bounds.size(); i += 2 * step) {
+                const size_t last = std::min(i + 2 * step, bounds.size() - 1);
+                std::inplace_merge(result.begin() + bounds[i], result.begin() + bounds[i + step],
+                                   result.begin() + bounds[last], by_key);
+            }
+        }
+        return result;
+    }
+
+    size_t GetBucketCount() const {
+        return buckets_.size();
+    }
+
 private:
-    const uint64_t BUCKET_COUNT;
-    std::vector<std::mutex> part_mutex_;
-    std::vector<std::map<Key, Value>> divided_map_;
-    std::atomic_uint64_t next_insertion_ = 0;
-};
\ No newline at end of file
+    std::vector<Bucket> buckets_;
+
+    Bucket& GetBucket(const Key& key) {
+        return buckets_[static_cast<uint64_t>(key) % buckets_.size()];
+    }
+};
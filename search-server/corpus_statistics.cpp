@@ -0,0 +1,34 @@
+#include "corpus_statistics.h"
+
+using namespace std;
+
+void CorpusStatistics::AddDocument(const map<string_view, double>& word_freqs) {
+    for (const auto& [word, _] : word_freqs) {
+        const TermDictionary::TermId term_id = terms_.Intern(word);
+        document_freqs_.resize(terms_.size());
+        ++document_freqs_[term_id];
+    }
+    ++document_count_;
+    ++generation_;
+}
+
+void CorpusStatistics::RemoveDocument(const map<string_view, double>& word_freqs) {
+    for (const auto& [word, _] : word_freqs) {
+        --document_freqs_[terms_.Find(word)];
+    }
+    --document_count_;
+    ++generation_;
+}
+
+size_t CorpusStatistics::GetDocumentCount() const {
+    return document_count_;
+}
+
+uint32_t CorpusStatistics::GetDocumentFreq(string_view word) const {
+    const TermDictionary::TermId term_id = terms_.Find(word);
+    return term_id == TermDictionary::NO_TERM ? 0 : document_freqs_[term_id];
+}
+
+uint64_t CorpusStatistics::GetGeneration() const {
+    return generation_;
+}
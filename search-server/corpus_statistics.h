@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string_view>
+#include <vector>
+#include "term_dictionary.h"
+
+using namespace std;
+
+// Document frequencies of words over several indexes, so each of them scores with the IDF of the whole corpus
+class CorpusStatistics {
+public:
+    // Takes the words of a document, as returned by SearchServer::GetWordFrequencies
+    void AddDocument(const map<string_view, double>& word_freqs);
+    void RemoveDocument(const map<string_view, double>& word_freqs);
+
+    size_t GetDocumentCount() const;
+
+    // Zero for unknown words
+    uint32_t GetDocumentFreq(string_view word) const;
+
+    // Bumped by every change
+    uint64_t GetGeneration() const;
+
+private:
+    TermDictionary terms_;
+    vector<uint32_t> document_freqs_; // Indexed by TermId
+    size_t document_count_ = 0;
+    uint64_t generation_ = 0;
+};
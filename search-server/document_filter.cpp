@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include "document_filter.h"
+
+using namespace std;
+
+namespace {
+
+void SortUnique(vector<int>& values) {
+    sort(values.begin(), values.end());
+    values.erase(unique(values.begin(), values.end()), values.end());
+}
+
+uint64_t CombineHash(uint64_t hash, uint64_t value) {
+    return MixBits(hash ^ (value + 0x9e3779b97f4a7c15ULL));
+}
+
+}
+
+DocumentFilter& DocumentFilter::SetStatuses(const vector<DocumentStatus>& statuses) {
+    status_mask_ = 0;
+    for (DocumentStatus status : statuses) {
+        status_mask_ |= uint32_t{1} << static_cast<int>(status);
+    }
+    hash_ = ComputeHash();
+    return *this;
+}
+
+DocumentFilter& DocumentFilter::SetRatingRange(int min_rating, int max_rating) {
+    if (min_rating > max_rating) {
+        throw invalid_argument("Rating range is empty"s);
+    }
+    min_rating_ = min_rating;
+    max_rating_ = max_rating;
+    hash_ = ComputeHash();
+    return *this;
+}
+
+DocumentFilter& DocumentFilter::SetAllowedIds(vector<int> document_ids) {
+    SortUnique(document_ids);
+    allowed_ids_ = move(document_ids);
+    has_allowed_ids_ = true;
+    hash_ = ComputeHash();
+    return *this;
+}
+
+DocumentFilter& DocumentFilter::SetDeniedIds(vector<int> document_ids) {
+    SortUnique(document_ids);
+    denied_ids_ = move(document_ids);
+    hash_ = ComputeHash();
+    return *this;
+}
+
+bool DocumentFilter::operator()(int document_id, DocumentStatus status, int rating) const {
+    return (status_mask_ >> static_cast<int>(status) & 1)
+           && rating >= min_rating_ && rating <= max_rating_
+           && (!has_allowed_ids_ || binary_search(allowed_ids_.begin(), allowed_ids_.end(), document_id))
+           && !binary_search(denied_ids_.begin(), denied_ids_.end(), document_id);
+}
+
+bool DocumentFilter::HasAllowedIds() const {
+    return has_allowed_ids_;
+}
+
+const vector<int>& DocumentFilter::GetAllowedIds() const {
+    return allowed_ids_;
+}
+
+bool DocumentFilter::operator==(const DocumentFilter& other) const {
+    return status_mask_ == other.status_mask_ && min_rating_ == other.min_rating_
+           && max_rating_ == other.max_rating_ && has_allowed_ids_ == other.has_allowed_ids_
+           && allowed_ids_ == other.allowed_ids_ && denied_ids_ == other.denied_ids_;
+}
+
+uint64_t DocumentFilter::GetHash() const {
+    return hash_;
+}
+
+uint64_t DocumentFilter::ComputeHash() const {
+    uint64_t hash = CombineHash(status_mask_, static_cast<uint32_t>(min_rating_));
+    hash = CombineHash(hash, static_cast<uint32_t>(max_rating_));
+    // List sizes separate the allowed ids from the denied ones
+    hash = CombineHash(hash, has_allowed_ids_ ? allowed_ids_.size() + 1 : 0);
+    for (int id : allowed_ids_) {
+        hash = CombineHash(hash, static_cast<uint32_t>(id));
+    }
+    hash = CombineHash(hash, denied_ids_.size());
+    for (int id : denied_ids_) {
+        hash = CombineHash(hash, static_cast<uint32_t>(id));
+    }
+    return hash;
+}
+
+FilterBitmapCache::FilterBitmapCache(const FilterBitmapCache&) {
+}
+
+FilterBitmapCache& FilterBitmapCache::operator=(const FilterBitmapCache& other) {
+    if (this != &other) {
+        lock_guard guard(guard_);
+        bitmaps_.clear();
+    }
+    return *this;
+}
+
+FilterBitmapCache::Compilation FilterBitmapCache::Find(const DocumentFilter& filter, uint64_t generation) const {
+    lock_guard guard(guard_);
+    auto it = bitmaps_.find(filter.GetHash());
+    if (it == bitmaps_.end() || it->second.generation != generation || !(it->second.filter == filter)) {
+        return {};
+    }
+    return it->second.compilation;
+}
+
+uint64_t FilterBitmapCache::Insert(const DocumentFilter& filter, uint64_t generation, shared_ptr<const Bitmap> bitmap) {
+    static atomic<uint64_t> next_id = 1;
+    const uint64_t id = next_id.fetch_add(1, memory_order_relaxed);
+    lock_guard guard(guard_);
+    if (bitmaps_.size() >= CAPACITY && bitmaps_.count(filter.GetHash()) == 0) {
+        // Bitmaps of older generations are useless, the rest is dropped only when there are none
+        for (auto it = bitmaps_.begin(); it != bitmaps_.end();) {
+            it = it->second.generation != generation ? bitmaps_.erase(it) : next(it);
+        }
+        if (bitmaps_.size() >= CAPACITY) {
+            bitmaps_.clear();
+        }
+    }
+    bitmaps_.insert_or_assign(filter.GetHash(), Entry{filter, generation, {move(bitmap), id}});
+    return id;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "bitmap.h"
+#include "document.h"
+#include "fingerprint.h"
+
+using namespace std;
+
+// Declarative document predicate. SearchServer compiles it into a bitmap of accepted documents
+// instead of calling it for every posting. It is a regular predicate elsewhere
+class DocumentFilter {
+public:
+    // Every status by default
+    DocumentFilter& SetStatuses(const vector<DocumentStatus>& statuses);
+
+    // Inclusive, throws invalid_argument for an empty range
+    DocumentFilter& SetRatingRange(int min_rating, int max_rating);
+
+    // Only these documents pass, all stored ones by default
+    DocumentFilter& SetAllowedIds(vector<int> document_ids);
+
+    DocumentFilter& SetDeniedIds(vector<int> document_ids);
+
+    bool operator()(int document_id, DocumentStatus status, int rating) const;
+
+    bool HasAllowedIds() const;
+    const vector<int>& GetAllowedIds() const;
+
+    // Equal for filters accepting the same documents by the same conditions
+    bool operator==(const DocumentFilter& other) const;
+
+    // Of the conditions, computed by the setters so that queries do not go over the id lists
+    uint64_t GetHash() const;
+
+private:
+    uint32_t status_mask_ = ~uint32_t{0};
+    int min_rating_ = numeric_limits<int>::min();
+    int max_rating_ = numeric_limits<int>::max();
+    bool has_allowed_ids_ = false;
+    vector<int> allowed_ids_; // Sorted and unique
+    vector<int> denied_ids_;  // Sorted and unique
+    uint64_t hash_ = ComputeHash();
+
+    uint64_t ComputeHash() const;
+};
+
+// Compiled filter bitmaps by filter hash, valid for one corpus generation. Safe for concurrent readers
+class FilterBitmapCache {
+public:
+    // Ids are unique within the process, so results cached for one cannot be mistaken for another filter's
+    struct Compilation {
+        shared_ptr<const Bitmap> bitmap;
+        uint64_t id = 0;
+    };
+
+    FilterBitmapCache() = default;
+
+    // Entries are not copied
+    FilterBitmapCache(const FilterBitmapCache&);
+    FilterBitmapCache& operator=(const FilterBitmapCache&);
+
+    // Null bitmap if the filter was not compiled for this generation
+    Compilation Find(const DocumentFilter& filter, uint64_t generation) const;
+    // Returns the id of the new compilation. A filter with the same hash is replaced
+    uint64_t Insert(const DocumentFilter& filter, uint64_t generation, shared_ptr<const Bitmap> bitmap);
+
+private:
+    static const size_t CAPACITY = 64;
+
+    struct Entry {
+        DocumentFilter filter; // Tells filters with equal hashes apart
+        uint64_t generation;
+        Compilation compilation;
+    };
+
+    mutable mutex guard_;
+    unordered_map<uint64_t, Entry> bitmaps_; // By filter hash
+};
@@ -0,0 +1,68 @@
+#include "document_store.h"
+
+using namespace std;
+
+DocumentStore::Ordinal DocumentStore::Add(int document_id, int rating, DocumentStatus status) {
+    const Ordinal ordinal = static_cast<Ordinal>(ids_.size());
+    ids_.push_back(document_id);
+    ratings_.push_back(rating);
+    statuses_.push_back(status);
+    removed_.Resize(ids_.size());
+    for (Bitmap& stored : stored_by_status_) {
+        stored.Resize(ids_.size());
+    }
+    stored_by_status_[static_cast<size_t>(status)].Set(ordinal);
+    ordinals_.emplace(document_id, ordinal);
+    sorted_ids_.insert(document_id);
+    return ordinal;
+}
+
+DocumentStore::Ordinal DocumentStore::Remove(int document_id) {
+    auto it = ordinals_.find(document_id);
+    if (it == ordinals_.end()) {
+        return NO_DOCUMENT;
+    }
+    const Ordinal ordinal = it->second;
+    ordinals_.erase(it);
+    sorted_ids_.erase(document_id);
+    removed_.Set(ordinal);
+    stored_by_status_[static_cast<size_t>(statuses_[ordinal])].Reset(ordinal);
+    return ordinal;
+}
+
+DocumentStore::Ordinal DocumentStore::FindOrdinal(int document_id) const {
+    auto it = ordinals_.find(document_id);
+    return it == ordinals_.end() ? NO_DOCUMENT : it->second;
+}
+
+vector<DocumentStore::Ordinal> DocumentStore::Renumber() {
+    vector<Ordinal> new_ordinals(ids_.size(), NO_DOCUMENT);
+    DocumentStore renumbered;
+    for (Ordinal ordinal = 0; ordinal < ids_.size(); ++ordinal) {
+        if (!removed_.Test(ordinal)) {
+            new_ordinals[ordinal] = renumbered.Add(ids_[ordinal], ratings_[ordinal], statuses_[ordinal]);
+        }
+    }
+    *this = move(renumbered);
+    return new_ordinals;
+}
+
+bool DocumentStore::IsStored(Ordinal ordinal) const {
+    return !removed_.Test(ordinal);
+}
+
+size_t DocumentStore::size() const {
+    return ordinals_.size();
+}
+
+size_t DocumentStore::GetOrdinalCount() const {
+    return ids_.size();
+}
+
+DocumentStore::const_iterator DocumentStore::begin() const {
+    return const_iterator(sorted_ids_.begin());
+}
+
+DocumentStore::const_iterator DocumentStore::end() const {
+    return const_iterator(sorted_ids_.end());
+}
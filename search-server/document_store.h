@@ -0,0 +1,127 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include "bitmap.h"
+#include "document.h"
+
+using namespace std;
+
+// Document metadata stored as parallel arrays indexed by a dense ordinal.
+// External ids stay sparse and are mapped to ordinals, which are never reused:
+// a removed document keeps its slot and is marked in the tombstone bitmap until Renumber.
+class DocumentStore {
+public:
+    using Ordinal = uint32_t;
+    static constexpr Ordinal NO_DOCUMENT = numeric_limits<Ordinal>::max();
+    static constexpr size_t STATUS_COUNT = 4; // Values of DocumentStatus
+
+    // Iterates over external ids of stored documents in ascending order
+    class const_iterator {
+    public:
+        using iterator_category = forward_iterator_tag;
+        using value_type = int;
+        using difference_type = ptrdiff_t;
+        using pointer = const int*;
+        using reference = const int&;
+
+        explicit const_iterator(set<int>::const_iterator it)
+            : it_(it) {
+        }
+
+        reference operator*() const {
+            return *it_;
+        }
+
+        pointer operator->() const {
+            return &*it_;
+        }
+
+        const_iterator& operator++() {
+            ++it_;
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            auto prev = *this;
+            ++it_;
+            return prev;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return it_ == other.it_;
+        }
+
+        bool operator!=(const const_iterator& other) const {
+            return it_ != other.it_;
+        }
+
+    private:
+        set<int>::const_iterator it_;
+    };
+
+    // The caller guarantees that document_id is not stored yet
+    Ordinal Add(int document_id, int rating, DocumentStatus status);
+
+    // Marks the document removed, returns NO_DOCUMENT if document_id is not stored
+    Ordinal Remove(int document_id);
+
+    // NO_DOCUMENT if document_id is not stored
+    Ordinal FindOrdinal(int document_id) const;
+
+    // Drops the slots of removed documents, stored ones keep their order.
+    // Returns the new ordinal of every old one, NO_DOCUMENT for removed documents
+    vector<Ordinal> Renumber();
+
+    int GetId(Ordinal ordinal) const {
+        return ids_[ordinal];
+    }
+
+    int GetRating(Ordinal ordinal) const {
+        return ratings_[ordinal];
+    }
+
+    DocumentStatus GetStatus(Ordinal ordinal) const {
+        return statuses_[ordinal];
+    }
+
+    bool IsRemoved(Ordinal ordinal) const {
+        return removed_.Test(ordinal);
+    }
+
+    // Stored and has the status, one bit test instead of two lookups
+    bool HasStatus(Ordinal ordinal, DocumentStatus status) const {
+        return stored_by_status_[static_cast<size_t>(status)].Test(ordinal);
+    }
+
+    // Stored documents with the status, indexed by ordinal
+    const Bitmap& GetStatusBitmap(DocumentStatus status) const {
+        return stored_by_status_[static_cast<size_t>(status)];
+    }
+
+    // False for ordinals of removed documents
+    bool IsStored(Ordinal ordinal) const;
+
+    // Number of stored documents
+    size_t size() const;
+
+    // Number of ordinals handed out so far, removed documents included
+    size_t GetOrdinalCount() const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+private:
+    vector<int> ids_;
+    vector<int> ratings_;
+    vector<DocumentStatus> statuses_;
+    unordered_map<int, Ordinal> ordinals_; // Stored documents only
+    set<int> sorted_ids_; // Stored documents only, for iteration in ascending order
+    Bitmap removed_;
+    array<Bitmap, STATUS_COUNT> stored_by_status_;
+};
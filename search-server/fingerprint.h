@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// 128-bit hash of a document's set of terms. Documents with equal fingerprints are duplicates
+struct Fingerprint {
+    uint64_t high = 0;
+    uint64_t low = 0;
+
+    bool operator==(const Fingerprint& other) const {
+        return high == other.high && low == other.low;
+    }
+
+    bool operator<(const Fingerprint& other) const {
+        return high != other.high ? high < other.high : low < other.low;
+    }
+};
+
+struct FingerprintHasher {
+    size_t operator()(const Fingerprint& fingerprint) const {
+        // Both halves are already well mixed
+        return static_cast<size_t>(fingerprint.low);
+    }
+};
+
+// Finalizer of MurmurHash3
+inline uint64_t MixBits(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+// Terms must be added in a canonical order, the halves use independent seeds
+class FingerprintBuilder {
+public:
+    void Add(uint64_t term) {
+        high_ = MixBits(high_ ^ (term + 0x9e3779b97f4a7c15ULL));
+        low_ = MixBits(low_ + term * 0xc2b2ae3d27d4eb4fULL);
+        ++count_;
+    }
+
+    Fingerprint Get() const {
+        return {MixBits(high_ ^ count_), MixBits(low_ ^ count_)};
+    }
+
+private:
+    uint64_t high_ = 0x243f6a8885a308d3ULL;
+    uint64_t low_ = 0x13198a2e03707344ULL;
+    uint64_t count_ = 0;
+};
+
+// Document kept as the original and the documents with the same set of words
+struct DuplicateGroup {
+    int original_id;
+    vector<int> duplicate_ids;
+};
@@ -0,0 +1,439 @@
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "index_snapshot.h"
+
+using namespace std;
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = {'S', 'S', 'I', 'N', 'D', 'E', 'X', '\0'};
+
+// FNV-1a over 64-bit words, the body is always a multiple of 8 bytes
+uint64_t ComputeChecksum(const char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Accumulates 8-byte aligned sections placed right after the header
+class SnapshotWriter {
+public:
+    template <typename T>
+    uint64_t Append(const vector<T>& values) {
+        const uint64_t offset = sizeof(SnapshotHeader) + body_.size();
+        const size_t size = values.size() * sizeof(T);
+        body_.resize(body_.size() + (size + 7) / 8 * 8, '\0');
+        if (size > 0) {
+            memcpy(body_.data() + offset - sizeof(SnapshotHeader), values.data(), size);
+        }
+        return offset;
+    }
+
+    const vector<char>& GetBody() const {
+        return body_;
+    }
+
+private:
+    vector<char> body_;
+};
+
+// Concatenates words into text and returns offsets of their beginnings plus the total size
+template <typename Container>
+vector<uint64_t> JoinWords(const Container& words, vector<char>& text) {
+    vector<uint64_t> offsets;
+    offsets.reserve(words.size() + 1);
+    for (string_view word : words) {
+        offsets.push_back(text.size());
+        text.insert(text.end(), word.begin(), word.end());
+    }
+    offsets.push_back(text.size());
+    return offsets;
+}
+
+} // namespace
+
+void IndexSnapshot::Save(const SearchServer& search_server, const string& path) {
+    using Ordinal = DocumentStore::Ordinal;
+    const DocumentStore& documents = search_server.documents_;
+
+    // Stored documents get dense snapshot ordinals, removed ones are skipped
+    vector<uint32_t> ordinal_map(documents.GetOrdinalCount(), NO_INDEX);
+    vector<int32_t> document_ids;
+    vector<int32_t> document_ratings;
+    vector<int32_t> document_statuses;
+    for (Ordinal ordinal = 0; ordinal < documents.GetOrdinalCount(); ++ordinal) {
+        if (!documents.IsStored(ordinal)) {
+            continue;
+        }
+        ordinal_map[ordinal] = static_cast<uint32_t>(document_ids.size());
+        document_ids.push_back(documents.GetId(ordinal));
+        document_ratings.push_back(documents.GetRating(ordinal));
+        document_statuses.push_back(static_cast<int32_t>(documents.GetStatus(ordinal)));
+    }
+    vector<SnapshotIdEntry> id_index;
+    for (uint32_t i = 0; i < document_ids.size(); ++i) {
+        id_index.push_back({document_ids[i], i});
+    }
+    sort(id_index.begin(), id_index.end(), [](const SnapshotIdEntry& lhs, const SnapshotIdEntry& rhs) {
+        return lhs.document_id < rhs.document_id;
+    });
+
+    // Terms without stored documents are dropped, the rest is sorted for binary search
+    vector<TermDictionary::TermId> term_ids;
+    for (TermDictionary::TermId term_id = 0; term_id < search_server.terms_.size(); ++term_id) {
+        if (search_server.document_freqs_[term_id] != 0) {
+            term_ids.push_back(term_id);
+        }
+    }
+    sort(term_ids.begin(), term_ids.end(), [&search_server](auto lhs, auto rhs) {
+        return search_server.terms_.GetTerm(lhs) < search_server.terms_.GetTerm(rhs);
+    });
+    vector<uint32_t> term_index_map(search_server.terms_.size(), NO_INDEX);
+    vector<string_view> term_words;
+    for (uint32_t i = 0; i < term_ids.size(); ++i) {
+        term_index_map[term_ids[i]] = i;
+        term_words.push_back(search_server.terms_.GetTerm(term_ids[i]));
+    }
+    vector<char> term_text;
+    const vector<uint64_t> term_offsets = JoinWords(term_words, term_text);
+
+    vector<uint64_t> term_postings = {0};
+    vector<double> term_idf;
+    vector<SnapshotPosting> postings;
+    search_server.VisitPostings([&](const auto& postings_by_term) {
+        for (TermDictionary::TermId term_id : term_ids) {
+            for (const Posting& posting : postings_by_term[term_id]) {
+                if (ordinal_map[posting.ordinal] != NO_INDEX) {
+                    postings.push_back({ordinal_map[posting.ordinal], 0, posting.term_freq});
+                }
+            }
+            term_postings.push_back(postings.size());
+            // As the server scores, so shards keep the IDF of their attached corpus statistics
+            term_idf.push_back(search_server.ComputeWordInverseDocumentFreq(term_id));
+        }
+    });
+
+    vector<uint64_t> document_terms_offsets = {0};
+    vector<SnapshotPosting> document_terms;
+    for (Ordinal ordinal = 0; ordinal < documents.GetOrdinalCount(); ++ordinal) {
+        if (ordinal_map[ordinal] == NO_INDEX) {
+            continue;
+        }
+        for (const auto& [term_id, term_freq] : search_server.word_freqs_by_ordinal_[ordinal]) {
+            document_terms.push_back({term_index_map[term_id], 0, term_freq});
+        }
+        document_terms_offsets.push_back(document_terms.size());
+    }
+
+    vector<char> stop_word_text;
+    const vector<uint64_t> stop_word_offsets = JoinWords(search_server.stop_words_, stop_word_text);
+
+    SnapshotHeader header = {};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = VERSION;
+    header.header_size = sizeof(SnapshotHeader);
+    header.max_result_document_count = search_server.max_result_document_count_;
+    header.term_count = term_ids.size();
+    header.document_count = document_ids.size();
+    header.posting_count = postings.size();
+    header.document_term_count = document_terms.size();
+    header.stop_word_count = search_server.stop_words_.size();
+
+    SnapshotWriter writer;
+    header.term_text_offset = writer.Append(term_text);
+    header.term_offsets_offset = writer.Append(term_offsets);
+    header.term_postings_offset = writer.Append(term_postings);
+    header.term_idf_offset = writer.Append(term_idf);
+    header.postings_offset = writer.Append(postings);
+    header.document_ids_offset = writer.Append(document_ids);
+    header.document_ratings_offset = writer.Append(document_ratings);
+    header.document_statuses_offset = writer.Append(document_statuses);
+    header.id_index_offset = writer.Append(id_index);
+    header.document_terms_offsets_offset = writer.Append(document_terms_offsets);
+    header.document_terms_offset = writer.Append(document_terms);
+    header.stop_word_text_offset = writer.Append(stop_word_text);
+    header.stop_word_offsets_offset = writer.Append(stop_word_offsets);
+
+    const vector<char>& body = writer.GetBody();
+    header.body_size = body.size();
+    header.checksum = ComputeChecksum(body.data(), body.size());
+
+    ofstream out(path, ios::binary | ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(body.data(), body.size());
+    if (!out) {
+        throw runtime_error("Failed to write snapshot "s + path);
+    }
+}
+
+IndexSnapshot::IndexSnapshot(const string& path, bool verify_checksum) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("Failed to open snapshot "s + path);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(SnapshotHeader)) {
+        close(fd);
+        throw runtime_error("Snapshot "s + path + " is truncated"s);
+    }
+    size_ = file_stat.st_size;
+    void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw runtime_error("Failed to map snapshot "s + path);
+    }
+    data_ = static_cast<const char*>(mapping);
+    header_ = reinterpret_cast<const SnapshotHeader*>(data_);
+
+    try {
+        if (memcmp(header_->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+            throw runtime_error("Snapshot "s + path + " has no valid header"s);
+        }
+        if (header_->version != VERSION || header_->header_size != sizeof(SnapshotHeader)) {
+            throw runtime_error("Snapshot "s + path + " has unsupported version "s + to_string(header_->version));
+        }
+        if (header_->body_size != size_ - sizeof(SnapshotHeader)) {
+            throw runtime_error("Snapshot "s + path + " is truncated"s);
+        }
+        if (verify_checksum
+            && ComputeChecksum(data_ + sizeof(SnapshotHeader), header_->body_size) != header_->checksum) {
+            throw runtime_error("Snapshot "s + path + " is corrupted"s);
+        }
+        // Every element takes at least a byte, larger counts cannot be real and would overflow below
+        for (uint64_t count : {header_->term_count, header_->document_count, header_->posting_count,
+                               header_->document_term_count, header_->stop_word_count}) {
+            if (count >= size_ || count >= NO_INDEX) {
+                throw runtime_error("Snapshot "s + path + " has invalid sizes"s);
+            }
+        }
+
+        term_offsets_ = GetSection<uint64_t>(header_->term_offsets_offset, header_->term_count + 1);
+        term_text_ = GetSection<char>(header_->term_text_offset, term_offsets_[header_->term_count]);
+        term_postings_ = GetSection<uint64_t>(header_->term_postings_offset, header_->term_count + 1);
+        term_idf_ = GetSection<double>(header_->term_idf_offset, header_->term_count);
+        postings_ = GetSection<SnapshotPosting>(header_->postings_offset, header_->posting_count);
+        document_ids_ = GetSection<int32_t>(header_->document_ids_offset, header_->document_count);
+        document_ratings_ = GetSection<int32_t>(header_->document_ratings_offset, header_->document_count);
+        document_statuses_ = GetSection<int32_t>(header_->document_statuses_offset, header_->document_count);
+        id_index_ = GetSection<SnapshotIdEntry>(header_->id_index_offset, header_->document_count);
+        document_terms_offsets_ = GetSection<uint64_t>(header_->document_terms_offsets_offset,
+                                                       header_->document_count + 1);
+        document_terms_ = GetSection<SnapshotPosting>(header_->document_terms_offset,
+                                                      header_->document_term_count);
+        stop_word_offsets_ = GetSection<uint64_t>(header_->stop_word_offsets_offset, header_->stop_word_count + 1);
+        stop_word_text_ = GetSection<char>(header_->stop_word_text_offset,
+                                           stop_word_offsets_[header_->stop_word_count]);
+        ValidateLayout();
+        if (verify_checksum) {
+            ValidateContents();
+        }
+    } catch (...) {
+        munmap(const_cast<char*>(data_), size_);
+        throw;
+    }
+}
+
+IndexSnapshot::~IndexSnapshot() {
+    munmap(const_cast<char*>(data_), size_);
+}
+
+vector<Document> IndexSnapshot::FindTopDocuments(string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments(raw_query, [status](int, DocumentStatus document_status, int) {
+        return document_status == status;
+    });
+}
+
+vector<Document> IndexSnapshot::FindTopDocuments(string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+tuple<vector<string_view>, DocumentStatus> IndexSnapshot::MatchDocument(string_view raw_query,
+                                                                        int document_id) const {
+    const uint32_t ordinal = FindOrdinal(document_id);
+    if (ordinal == NO_INDEX) {
+        throw std::out_of_range("MatchDocument: out_of_range");
+    }
+    if (raw_query.empty()) {
+        throw std::invalid_argument("MatchDocument: invalid_argument");
+    }
+    const auto status = static_cast<DocumentStatus>(document_statuses_[ordinal]);
+
+    auto query = ParseQuery(raw_query);
+    query.MakeUnique();
+
+    for (string_view word : query.minus_words) {
+        const uint32_t term_index = FindTerm(word);
+        if (term_index != NO_INDEX && ContainsPosting(term_index, ordinal)) {
+            return {vector<string_view>(), status};
+        }
+    }
+
+    // Plus words are sorted and unique already
+    vector<string_view> matched_words;
+    for (string_view word : query.plus_words) {
+        const uint32_t term_index = FindTerm(word);
+        if (term_index != NO_INDEX && ContainsPosting(term_index, ordinal)) {
+            matched_words.push_back(GetTerm(term_index));
+        }
+    }
+    return {matched_words, status};
+}
+
+map<string_view, double> IndexSnapshot::GetWordFrequencies(int document_id) const {
+    map<string_view, double> word_freqs;
+    const uint32_t ordinal = FindOrdinal(document_id);
+    if (ordinal != NO_INDEX) {
+        for (uint64_t i = document_terms_offsets_[ordinal]; i < document_terms_offsets_[ordinal + 1]; ++i) {
+            if (document_terms_[i].index >= header_->term_count) {
+                throw runtime_error("Snapshot document terms are invalid"s);
+            }
+            word_freqs.emplace(GetTerm(document_terms_[i].index), document_terms_[i].term_freq);
+        }
+    }
+    return word_freqs;
+}
+
+int IndexSnapshot::GetDocumentCount() const {
+    return static_cast<int>(header_->document_count);
+}
+
+template <typename T>
+const T* IndexSnapshot::GetSection(uint64_t offset, uint64_t count) const {
+    if (offset % alignof(T) != 0 || offset > size_ || count > (size_ - offset) / sizeof(T)) {
+        throw runtime_error("Snapshot section is out of file bounds"s);
+    }
+    return reinterpret_cast<const T*>(data_ + offset);
+}
+
+void IndexSnapshot::ValidateLayout() const {
+    // Offsets start at zero and never decrease, so all of them are within the section they index
+    auto check_offsets = [](const uint64_t* offsets, uint64_t count, uint64_t total, const char* name) {
+        if (offsets[0] != 0 || offsets[count] != total) {
+            throw runtime_error("Snapshot "s + name + " offsets are inconsistent"s);
+        }
+        for (uint64_t i = 0; i < count; ++i) {
+            if (offsets[i] > offsets[i + 1]) {
+                throw runtime_error("Snapshot "s + name + " offsets are not sorted"s);
+            }
+        }
+    };
+    check_offsets(term_offsets_, header_->term_count, term_offsets_[header_->term_count], "term");
+    check_offsets(stop_word_offsets_, header_->stop_word_count, stop_word_offsets_[header_->stop_word_count],
+                  "stop word");
+    check_offsets(term_postings_, header_->term_count, header_->posting_count, "posting");
+    check_offsets(document_terms_offsets_, header_->document_count, header_->document_term_count, "document term");
+
+    // FindTerm and IsStopWord rely on the order for binary search
+    for (uint32_t i = 1; i < header_->term_count; ++i) {
+        if (GetTerm(i - 1) >= GetTerm(i)) {
+            throw runtime_error("Snapshot terms are not sorted"s);
+        }
+    }
+    for (uint32_t i = 1; i < header_->stop_word_count; ++i) {
+        if (GetStopWord(i - 1) >= GetStopWord(i)) {
+            throw runtime_error("Snapshot stop words are not sorted"s);
+        }
+    }
+
+    for (uint64_t ordinal = 0; ordinal < header_->document_count; ++ordinal) {
+        if (document_statuses_[ordinal] < 0
+            || document_statuses_[ordinal] >= static_cast<int32_t>(DocumentStore::STATUS_COUNT)) {
+            throw runtime_error("Snapshot document statuses are invalid"s);
+        }
+    }
+    // Unique ids that their ordinals map back to give every ordinal exactly one entry
+    for (uint64_t i = 0; i < header_->document_count; ++i) {
+        if (id_index_[i].ordinal >= header_->document_count
+            || document_ids_[id_index_[i].ordinal] != id_index_[i].document_id
+            || (i > 0 && id_index_[i].document_id <= id_index_[i - 1].document_id)) {
+            throw runtime_error("Snapshot id index is invalid"s);
+        }
+    }
+}
+
+void IndexSnapshot::ValidateContents() const {
+    // Postings of a term are strictly ascending, which binary searches rely on
+    for (uint64_t term_index = 0; term_index < header_->term_count; ++term_index) {
+        for (uint64_t i = term_postings_[term_index]; i < term_postings_[term_index + 1]; ++i) {
+            if (postings_[i].index >= header_->document_count
+                || (i > term_postings_[term_index] && postings_[i].index <= postings_[i - 1].index)) {
+                throw runtime_error("Snapshot postings are invalid"s);
+            }
+        }
+    }
+    for (uint64_t i = 0; i < header_->document_term_count; ++i) {
+        if (document_terms_[i].index >= header_->term_count) {
+            throw runtime_error("Snapshot document terms are invalid"s);
+        }
+    }
+}
+
+string_view IndexSnapshot::GetTerm(uint32_t term_index) const {
+    return {term_text_ + term_offsets_[term_index], term_offsets_[term_index + 1] - term_offsets_[term_index]};
+}
+
+string_view IndexSnapshot::GetStopWord(uint32_t index) const {
+    return {stop_word_text_ + stop_word_offsets_[index], stop_word_offsets_[index + 1] - stop_word_offsets_[index]};
+}
+
+bool IndexSnapshot::IsStopWord(string_view word) const {
+    uint32_t left = 0;
+    uint32_t right = static_cast<uint32_t>(header_->stop_word_count);
+    while (left < right) {
+        const uint32_t middle = left + (right - left) / 2;
+        if (GetStopWord(middle) < word) {
+            left = middle + 1;
+        } else {
+            right = middle;
+        }
+    }
+    return left < header_->stop_word_count && GetStopWord(left) == word;
+}
+
+uint32_t IndexSnapshot::FindTerm(string_view word) const {
+    uint32_t left = 0;
+    uint32_t right = static_cast<uint32_t>(header_->term_count);
+    while (left < right) {
+        const uint32_t middle = left + (right - left) / 2;
+        if (GetTerm(middle) < word) {
+            left = middle + 1;
+        } else {
+            right = middle;
+        }
+    }
+    return left < header_->term_count && GetTerm(left) == word ? left : NO_INDEX;
+}
+
+uint32_t IndexSnapshot::FindOrdinal(int document_id) const {
+    const SnapshotIdEntry* first = id_index_;
+    const SnapshotIdEntry* last = id_index_ + header_->document_count;
+    auto it = lower_bound(first, last, document_id, [](const SnapshotIdEntry& entry, int id) {
+        return entry.document_id < id;
+    });
+    return it != last && it->document_id == document_id ? it->ordinal : NO_INDEX;
+}
+
+bool IndexSnapshot::ContainsPosting(uint32_t term_index, uint32_t ordinal) const {
+    const SnapshotPosting* first = postings_ + term_postings_[term_index];
+    const SnapshotPosting* last = postings_ + term_postings_[term_index + 1];
+    auto it = lower_bound(first, last, ordinal, [](const SnapshotPosting& posting, uint32_t value) {
+        return posting.index < value;
+    });
+    return it != last && it->index == ordinal;
+}
+
+SearchServer::Query IndexSnapshot::ParseQuery(string_view raw_query) const {
+    return SearchServer::ParseQuery(raw_query, [this](string_view word) { return IsStopWord(word); });
+}
@@ -0,0 +1,189 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+#include "bitmap.h"
+#include "document.h"
+#include "search_server.h"
+
+using namespace std;
+
+// Posting of a snapshot. The same layout serves per-document term lists, then index is a term index
+struct SnapshotPosting {
+    uint32_t index;
+    uint32_t reserved;
+    double term_freq;
+};
+
+struct SnapshotIdEntry {
+    int32_t document_id;
+    uint32_t ordinal;
+};
+
+// Sections are addressed by their offsets from the beginning of the file, every one is 8-byte aligned
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t checksum; // Of everything after the header
+    uint64_t body_size;
+    uint64_t max_result_document_count;
+
+    uint64_t term_count;
+    uint64_t document_count;
+    uint64_t posting_count;
+    uint64_t document_term_count;
+    uint64_t stop_word_count;
+
+    uint64_t term_text_offset;         // char[], terms sorted lexicographically
+    uint64_t term_offsets_offset;      // uint64_t[term_count + 1] into term text
+    uint64_t term_postings_offset;     // uint64_t[term_count + 1] into postings
+    uint64_t term_idf_offset;          // double[term_count]
+    uint64_t postings_offset;          // SnapshotPosting[posting_count], index is an ordinal
+    uint64_t document_ids_offset;      // int32_t[document_count]
+    uint64_t document_ratings_offset;  // int32_t[document_count]
+    uint64_t document_statuses_offset; // int32_t[document_count]
+    uint64_t id_index_offset;          // SnapshotIdEntry[document_count] sorted by id
+    uint64_t document_terms_offsets_offset; // uint64_t[document_count + 1] into document terms
+    uint64_t document_terms_offset;    // SnapshotPosting[document_term_count], index is a term index
+    uint64_t stop_word_text_offset;    // char[], stop words sorted lexicographically
+    uint64_t stop_word_offsets_offset; // uint64_t[stop_word_count + 1] into stop word text
+};
+
+// Read-only SearchServer index mapped from a binary snapshot file.
+// Queries are served straight from the mapped pages, nothing is deserialized.
+class IndexSnapshot {
+public:
+    static const uint32_t VERSION = 1;
+
+    // Writes a snapshot of the current index, removed documents are dropped.
+    // IDF is stored as the server computes it, attached corpus statistics included
+    static void Save(const SearchServer& search_server, const string& path);
+
+    // Throws runtime_error if the file is not a valid snapshot of this version.
+    // Opening checks offsets, term order and the id index in time linear in terms and documents.
+    // Postings and document terms are checked in full along with the checksum, otherwise as queries read them
+    explicit IndexSnapshot(const string& path, bool verify_checksum = true);
+    ~IndexSnapshot();
+
+    IndexSnapshot(const IndexSnapshot&) = delete;
+    IndexSnapshot& operator=(const IndexSnapshot&) = delete;
+
+    template <typename DocumentPredicate>
+    vector<Document> FindTopDocuments(string_view raw_query, DocumentPredicate document_predicate) const;
+    vector<Document> FindTopDocuments(string_view raw_query, DocumentStatus status) const;
+    vector<Document> FindTopDocuments(string_view raw_query) const;
+
+    // Returned words point into the mapped file
+    tuple<vector<string_view>, DocumentStatus> MatchDocument(string_view raw_query, int document_id) const;
+
+    map<string_view, double> GetWordFrequencies(int document_id) const;
+
+    int GetDocumentCount() const;
+
+private:
+    static constexpr uint32_t NO_INDEX = numeric_limits<uint32_t>::max();
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    const SnapshotHeader* header_ = nullptr;
+
+    const char* term_text_ = nullptr;
+    const uint64_t* term_offsets_ = nullptr;
+    const uint64_t* term_postings_ = nullptr;
+    const double* term_idf_ = nullptr;
+    const SnapshotPosting* postings_ = nullptr;
+    const int32_t* document_ids_ = nullptr;
+    const int32_t* document_ratings_ = nullptr;
+    const int32_t* document_statuses_ = nullptr;
+    const SnapshotIdEntry* id_index_ = nullptr;
+    const uint64_t* document_terms_offsets_ = nullptr;
+    const SnapshotPosting* document_terms_ = nullptr;
+    const char* stop_word_text_ = nullptr;
+    const uint64_t* stop_word_offsets_ = nullptr;
+
+    template <typename T>
+    const T* GetSection(uint64_t offset, uint64_t count) const;
+
+    // Throws runtime_error unless offsets stay within their sections, terms and stop words are sorted
+    // and the id index maps every id to its ordinal. Reads no postings or document terms
+    void ValidateLayout() const;
+
+    // Throws runtime_error unless postings of every term are ascending ordinals
+    // and document terms are term indexes. Reads the whole index
+    void ValidateContents() const;
+
+    // Throws runtime_error if the posting is not an ordinal, which ValidateContents may have skipped
+    uint32_t GetOrdinal(const SnapshotPosting& posting) const {
+        if (posting.index >= header_->document_count) {
+            throw runtime_error("Snapshot postings are invalid"s);
+        }
+        return posting.index;
+    }
+
+    string_view GetTerm(uint32_t term_index) const;
+    string_view GetStopWord(uint32_t index) const;
+    bool IsStopWord(string_view word) const;
+
+    // NO_INDEX if the word is not indexed
+    uint32_t FindTerm(string_view word) const;
+
+    // NO_INDEX if the document is absent
+    uint32_t FindOrdinal(int document_id) const;
+
+    bool ContainsPosting(uint32_t term_index, uint32_t ordinal) const;
+
+    SearchServer::Query ParseQuery(string_view raw_query) const;
+};
+
+template <typename DocumentPredicate>
+vector<Document> IndexSnapshot::FindTopDocuments(string_view raw_query,
+                                                 DocumentPredicate document_predicate) const {
+    auto query = ParseQuery(raw_query);
+    query.MakeUnique();
+
+    Bitmap excluded(header_->document_count);
+    for (string_view word : query.minus_words) {
+        const uint32_t term_index = FindTerm(word);
+        if (term_index == NO_INDEX) {
+            continue;
+        }
+        for (uint64_t i = term_postings_[term_index]; i < term_postings_[term_index + 1]; ++i) {
+            excluded.Set(GetOrdinal(postings_[i]));
+        }
+    }
+
+    map<uint32_t, double> document_to_relevance;
+    for (string_view word : query.plus_words) {
+        const uint32_t term_index = FindTerm(word);
+        if (term_index == NO_INDEX) {
+            continue;
+        }
+        const double inverse_document_freq = term_idf_[term_index];
+        for (uint64_t i = term_postings_[term_index]; i < term_postings_[term_index + 1]; ++i) {
+            const uint32_t ordinal = GetOrdinal(postings_[i]);
+            if (!excluded.Test(ordinal)
+                && document_predicate(document_ids_[ordinal], static_cast<DocumentStatus>(document_statuses_[ordinal]),
+                                      document_ratings_[ordinal])) {
+                document_to_relevance[ordinal] += postings_[i].term_freq * inverse_document_freq;
+            }
+        }
+    }
+
+    vector<Document> matched_documents;
+    for (const auto [ordinal, relevance] : document_to_relevance) {
+        matched_documents.push_back({document_ids_[ordinal], relevance, document_ratings_[ordinal]});
+    }
+
+    const size_t top_count = min<size_t>(matched_documents.size(), header_->max_result_document_count);
+    partial_sort(matched_documents.begin(), matched_documents.begin() + top_count, matched_documents.end(),
+                 SearchServer::CompareDocuments);
+    matched_documents.resize(top_count);
+    return matched_documents;
+}
@@ -4,8 +4,37 @@
 
 #include "log_duration.h"
 
+#include "posting_list.h"
+
+#include "compressed_posting_list.h"
+
+#include "index_snapshot.h"
+
+#include "concurrent_map.h"
+
+#include "remove_duplicates.h"
+
+#include "near_duplicates.h"
+
+#include "sharded_search_server.h"
+
+#include "request_queue.h"
+
+#include "versioned_search_server.h"
+
+#include "metrics.h"
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
 #include <execution>
+#include <future>
 #include <iostream>
+#include <map>
+#include <numeric>
 #include <random>
 #include <string>
 #include <vector>
@@ -57,7 +86,7 @@ vector<string> GenerateQueries(mt19937& generator, const vector<string>& diction
 
 template <typename ExecutionPolicy>
 void Test(string_view mark, const SearchServer& search_server, const vector<string>& queries, ExecutionPolicy&& policy) {
-    LOG_DURATION(mark);
+    LOG_DURATION(static_cast<string>(mark));
     double total_relevance = 0;
     for (const string_view query : queries) {
         for (const auto& document : search_server.FindTopDocuments(policy, query)) {
@@ -67,6 +96,710 @@ void Test(string_view mark, const SearchServer& search_server, const vector<stri
     cout << total_relevance << endl;
 }
 
+// Queries with growing shares of minus words, most matched documents get excluded
+void BenchmarkMinusWords(mt19937& generator, const SearchServer& search_server, const vector<string>& dictionary) {
+    for (double minus_prob : {0.0, 0.1, 0.3}) {
+        vector<string> queries;
+        for (int i = 0; i < 100; ++i) {
+            queries.push_back(GenerateQuery(generator, dictionary, 70, minus_prob));
+        }
+        const string mark = "minus_prob "s + to_string(minus_prob);
+        Test(mark + ", seq"s, search_server, queries, execution::seq);
+        Test(mark + ", par"s, search_server, queries, execution::par);
+        LOG_DURATION(mark + ", MatchDocument"s);
+        size_t word_count = 0;
+        for (int id = 0; id < search_server.GetDocumentCount(); ++id) {
+            word_count += get<0>(search_server.MatchDocument(queries[id % queries.size()], id)).size();
+        }
+        cout << word_count << endl;
+    }
+}
+
+// Short queries over common words, where MaxScore skips most of the matched documents
+void BenchmarkDynamicPruning(mt19937& generator, SearchServer& search_server, const vector<string>& dictionary) {
+    for (int word_count : {2, 4, 8, 70}) {
+        vector<string> queries;
+        for (int i = 0; i < 300; ++i) {
+            queries.push_back(GenerateQuery(generator, dictionary, word_count));
+        }
+        for (bool pruning : {false, true}) {
+            search_server.SetDynamicPruning(pruning);
+            Test(to_string(word_count) + " words, pruning "s + (pruning ? "on"s : "off"s),
+                 search_server, queries, execution::seq);
+        }
+    }
+    search_server.SetDynamicPruning(true);
+}
+
+// Per-stage latencies of the sequential and parallel queries, empty when built without metrics
+void ReportQueryMetrics(const SearchServer& search_server, const vector<string>& queries) {
+    MetricsRegistry::Instance().Reset();
+    for (const string& query : queries) {
+        search_server.FindTopDocuments(execution::seq, query);
+        search_server.FindTopDocuments(execution::par, query);
+    }
+    cout << MetricsRegistry::Instance().GetSnapshot();
+}
+
+// Stress test: a writer publishes versions while query threads read snapshots.
+// A snapshot must never change under a reader, and its results must be documents of it
+void StressVersionedSearchServer(const string& stop_words, const vector<string>& documents,
+                                 const vector<string>& queries) {
+    VersionedSearchServer search_server(stop_words);
+    atomic<bool> writing = true;
+    atomic<int> query_count = 0;
+    atomic<int> error_count = 0;
+    LOG_DURATION("VersionedSearchServer stress"s);
+    vector<future<void>> readers;
+    for (size_t reader = 0; reader < 3; ++reader) {
+        readers.push_back(async(launch::async, [&, reader]() {
+            for (size_t i = reader; writing; i += 3) {
+                const auto snapshot = search_server.GetSnapshot();
+                const int document_count = snapshot->GetDocumentCount();
+                const string& query = queries[i % queries.size()];
+                for (const Document& document : snapshot->FindTopDocuments(query)) {
+                    const auto [words, _] = snapshot->MatchDocument(query, document.id);
+                    error_count += words.empty() ? 1 : 0;
+                }
+                error_count += snapshot->GetDocumentCount() != document_count ? 1 : 0;
+                ++query_count;
+            }
+        }));
+    }
+    const int added_count = 2'000;
+    for (int i = 0; i < added_count; ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        if (i % 4 == 3) {
+            search_server.RemoveDocument(i - 2);
+        }
+    }
+    writing = false;
+    for (auto& reader : readers) {
+        reader.get();
+    }
+    cout << search_server.GetVersion() << " versions, "s << query_count << " queries, "s
+         << error_count << " errors, "s << search_server.GetSnapshot()->GetDocumentCount()
+         << " documents"s << endl;
+}
+
+// Per-query latencies of a batch run by the standard parallel algorithms and by the server's pool,
+// then of single queries without and with intra-query parallelism on the pool
+void BenchmarkThreadPool(const SearchServer& search_server, const vector<string>& queries) {
+    auto report = [](const string& mark, const LatencyHistogram& histogram) {
+        const HistogramSnapshot snapshot = histogram.GetSnapshot();
+        cout << mark << ": p50 "s << snapshot.GetPercentile(50) / 1000 << " us, p99 "s
+             << snapshot.GetPercentile(99) / 1000 << " us"s << endl;
+    };
+    {
+        LatencyHistogram histogram;
+        {
+            LOG_DURATION("batch, execution::par"s);
+            vector<vector<Document>> results(queries.size());
+            transform(execution::par, queries.begin(), queries.end(), results.begin(), [&](const string& query) {
+                ScopedLatency latency(histogram);
+                return search_server.FindTopDocuments(query);
+            });
+        }
+        report("batch, execution::par"s, histogram);
+    }
+    {
+        LatencyHistogram histogram;
+        {
+            LOG_DURATION("batch, thread pool"s);
+            vector<vector<Document>> results(queries.size());
+            search_server.GetThreadPool().ParallelFor(queries.size(), [&](size_t index) {
+                ScopedLatency latency(histogram);
+                results[index] = search_server.FindTopDocuments(queries[index]);
+            });
+        }
+        report("batch, thread pool"s, histogram);
+    }
+    LatencyHistogram sequential_histogram;
+    LatencyHistogram parallel_histogram;
+    for (const string& query : queries) {
+        {
+            ScopedLatency latency(sequential_histogram);
+            search_server.FindTopDocuments(execution::seq, query);
+        }
+        {
+            ScopedLatency latency(parallel_histogram);
+            search_server.FindTopDocuments(execution::par, query);
+        }
+    }
+    report("single, seq"s, sequential_histogram);
+    report("single, par on "s + to_string(search_server.GetThreadPool().GetWorkerCount()) + " workers"s,
+           parallel_histogram);
+}
+
+// Asynchronous queries with shrinking latency budgets: latency is capped near the budget
+// at the cost of partial results
+void BenchmarkQueryDeadlines(const SearchServer& search_server, const vector<string>& queries) {
+    for (int budget_us : {0, 5'000, 1'000, 200}) {
+        LatencyHistogram histogram;
+        int partial_count = 0;
+        for (const string& query : queries) {
+            ScopedLatency latency(histogram);
+            const auto deadline = budget_us == 0 ? SearchServer::NO_DEADLINE
+                                                 : chrono::steady_clock::now() + chrono::microseconds(budget_us);
+            partial_count += search_server.SubmitQuery(query, deadline).get().is_partial ? 1 : 0;
+        }
+        const HistogramSnapshot snapshot = histogram.GetSnapshot();
+        cout << "budget "s << (budget_us == 0 ? "none"s : to_string(budget_us) + " us"s)
+             << ": p50 "s << snapshot.GetPercentile(50) / 1000 << " us, p99 "s
+             << snapshot.GetPercentile(99) / 1000 << " us, "s << partial_count << " partial"s << endl;
+    }
+}
+
+// Several threads push queries through one queue while the window statistics are read
+void BenchmarkRequestQueue(const SearchServer& search_server, const vector<string>& queries) {
+    RequestQueue request_queue(search_server);
+    {
+        LOG_DURATION("RequestQueue 4 threads"s);
+        vector<future<void>> workers;
+        for (size_t worker = 0; worker < 4; ++worker) {
+            workers.push_back(async(launch::async, [&, worker]() {
+                for (size_t i = worker; i < queries.size(); i += 4) {
+                    request_queue.AddFindRequest(queries[i]);
+                    // Longer than any dictionary word, nothing matches
+                    request_queue.AddFindRequest("unmatchedword"s);
+                }
+            }));
+        }
+        for (auto& worker : workers) {
+            worker.get();
+        }
+    }
+    const auto statistics = request_queue.GetStatistics();
+    cout << statistics.request_count << " requests, no result rate "s << statistics.no_result_rate
+         << ", latency p50 "s << statistics.latency_p50.count() << " us, p99 "s
+         << statistics.latency_p99.count() << " us"s << endl;
+}
+
+// Corpora where ACTUAL documents are a majority and a minority. A status argument is served by the status
+// bitmap, which MaxScore jumps over other documents with. A lambda with the same meaning is called per posting
+void BenchmarkStatusFilter(mt19937& generator, const vector<string>& dictionary, const vector<string>& documents,
+                           const vector<string>& queries) {
+    vector<string> short_queries;
+    for (int i = 0; i < 100; ++i) {
+        short_queries.push_back(GenerateQuery(generator, dictionary, 3));
+    }
+    auto is_actual = [](int, DocumentStatus status, int) {
+        return status == DocumentStatus::ACTUAL;
+    };
+    // Out of every five documents
+    for (int actual_count : {4, 1}) {
+        SearchServer search_server(dictionary[0]);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            const DocumentStatus status = static_cast<int>(i % 5) < actual_count ? DocumentStatus::ACTUAL
+                                                                                 : DocumentStatus::BANNED;
+            search_server.AddDocument(i, documents[i], status, {1, 2, 3});
+        }
+        const string share = to_string(actual_count * 20) + "% actual, "s;
+        for (bool is_short : {true, false}) {
+            for (bool by_status : {true, false}) {
+                LOG_DURATION(share + (is_short ? "short"s : "long"s) + (by_status ? ", status"s : ", lambda"s));
+                double total_relevance = 0;
+                for (const string& query : is_short ? short_queries : queries) {
+                    const auto found = by_status ? search_server.FindTopDocuments(query, DocumentStatus::ACTUAL)
+                                                 : search_server.FindTopDocuments(query, is_actual);
+                    for (const auto& document : found) {
+                        total_relevance += document.relevance;
+                    }
+                }
+                cout << total_relevance << endl;
+            }
+        }
+        for (bool by_status : {true, false}) {
+            LOG_DURATION(share + (by_status ? "par, status"s : "par, lambda"s));
+            double total_relevance = 0;
+            for (const string& query : queries) {
+                const auto found = by_status
+                                   ? search_server.FindTopDocuments(execution::par, query, DocumentStatus::ACTUAL)
+                                   : search_server.FindTopDocuments(execution::par, query, is_actual);
+                for (const auto& document : found) {
+                    total_relevance += document.relevance;
+                }
+            }
+            cout << total_relevance << endl;
+        }
+    }
+}
+
+// Status, rating and deny list conditions as a DocumentFilter and as the same check in a lambda
+void BenchmarkDocumentFilter(const string& stop_words, const vector<string>& documents, const vector<string>& queries) {
+    SearchServer search_server(stop_words);
+    const DocumentStatus statuses[] = {DocumentStatus::ACTUAL, DocumentStatus::BANNED, DocumentStatus::REMOVED,
+                                       DocumentStatus::IRRELEVANT};
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], statuses[i % size(statuses)], {static_cast<int>(i % 10)});
+    }
+    vector<int> denied_ids;
+    for (size_t i = 0; i < documents.size(); i += 97) {
+        denied_ids.push_back(i);
+    }
+    DocumentFilter filter;
+    filter.SetStatuses({DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT}).SetRatingRange(2, 6).SetDeniedIds(denied_ids);
+    auto lambda = [&denied_ids](int document_id, DocumentStatus status, int rating) {
+        return (status == DocumentStatus::ACTUAL || status == DocumentStatus::IRRELEVANT)
+               && rating >= 2 && rating <= 6
+               && !binary_search(denied_ids.begin(), denied_ids.end(), document_id);
+    };
+    for (bool pruning : {true, false}) {
+        search_server.SetDynamicPruning(pruning);
+        const string mark = pruning ? "pruned"s : "exhaustive"s;
+        for (bool by_filter : {true, false}) {
+            LOG_DURATION(mark + (by_filter ? ", filter"s : ", lambda"s));
+            double total_relevance = 0;
+            for (const string& query : queries) {
+                const auto found = by_filter ? search_server.FindTopDocuments(query, filter)
+                                             : search_server.FindTopDocuments(query, lambda);
+                for (const auto& document : found) {
+                    total_relevance += document.relevance;
+                }
+            }
+            cout << total_relevance << endl;
+        }
+    }
+    for (bool by_filter : {true, false}) {
+        LOG_DURATION(by_filter ? "par, filter"s : "par, lambda"s);
+        double total_relevance = 0;
+        for (const string& query : queries) {
+            const auto found = by_filter ? search_server.FindTopDocuments(execution::par, query, filter)
+                                         : search_server.FindTopDocuments(execution::par, query, lambda);
+            for (const auto& document : found) {
+                total_relevance += document.relevance;
+            }
+        }
+        cout << total_relevance << endl;
+    }
+}
+
+// Zipf-distributed traffic over a few hundred distinct queries, popular ones repeat a lot
+void BenchmarkResultCache(mt19937& generator, SearchServer& search_server, const vector<string>& dictionary) {
+    vector<string> distinct_queries;
+    vector<double> weights;
+    for (int rank = 1; rank <= 200; ++rank) {
+        distinct_queries.push_back(GenerateQuery(generator, dictionary, 8));
+        weights.push_back(1.0 / rank);
+    }
+    discrete_distribution<size_t> pick_query(weights.begin(), weights.end());
+    vector<string> queries;
+    for (int i = 0; i < 10'000; ++i) {
+        queries.push_back(distinct_queries[pick_query(generator)]);
+    }
+    for (size_t capacity : {0, 16, 64, 256}) {
+        search_server.SetResultCacheCapacity(capacity);
+        const auto before = search_server.GetResultCacheStatistics();
+        Test("result cache capacity "s + to_string(capacity), search_server, queries, execution::seq);
+        const auto after = search_server.GetResultCacheStatistics();
+        const uint64_t hits = after.hits - before.hits;
+        const uint64_t lookups = hits + after.misses - before.misses;
+        if (lookups != 0) {
+            cout << "hit rate "s << 100.0 * hits / lookups << "%"s << endl;
+        }
+    }
+    search_server.SetResultCacheCapacity(0);
+}
+
+// Same corpus and queries as the unsharded TEST runs, so the printed totals must match
+void BenchmarkShardedSearchServer(const string& stop_words, const vector<string>& documents,
+                                  const vector<string>& queries) {
+    for (size_t shard_count : {1, 2, 4, 8}) {
+        ShardedSearchServer search_server(stop_words, shard_count);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+        LOG_DURATION(to_string(shard_count) + " shards"s);
+        double total_relevance = 0;
+        for (const string_view query : queries) {
+            for (const auto& document : search_server.FindTopDocuments(query)) {
+                total_relevance += document.relevance;
+            }
+        }
+        cout << total_relevance << endl;
+    }
+}
+
+// Loads the same corpus document by document and with one AddDocuments batch
+void BenchmarkBulkLoad(const string& stop_words, const vector<string>& documents) {
+    {
+        SearchServer search_server(stop_words);
+        LOG_DURATION("AddDocument loop"s);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+        }
+    }
+    {
+        SearchServer search_server(stop_words);
+        LOG_DURATION("AddDocuments batch"s);
+        vector<SearchServer::NewDocument> batch;
+        batch.reserve(documents.size());
+        for (size_t i = 0; i < documents.size(); ++i) {
+            batch.push_back({static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {1, 2, 3}});
+        }
+        search_server.AddDocuments(batch);
+    }
+}
+
+// Tokenizer throughput over the whole corpus: split then validate every word vs the single-pass tokenizer
+void BenchmarkTokenizer(const vector<string>& documents) {
+    string text;
+    for (const string& document : documents) {
+        text += document;
+        text.push_back(' ');
+    }
+    const int repeat_count = 20;
+    const double gigabytes = static_cast<double>(text.size()) * repeat_count / 1e9;
+    auto report = [gigabytes](string_view mark, chrono::steady_clock::duration duration, size_t word_count) {
+        const double seconds = chrono::duration<double>(duration).count();
+        cout << mark << ": "s << gigabytes / seconds << " GB/s, "s << word_count << " words"s << endl;
+    };
+
+    size_t word_count = 0;
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < repeat_count; ++r) {
+        const auto words = SplitIntoWordsStringView(text);
+        for (string_view word : words) {
+            if (any_of(word.begin(), word.end(), [](char c) { return c >= '\0' && c < ' '; })) {
+                return;
+            }
+        }
+        word_count += words.size();
+    }
+    report("SplitIntoWordsStringView + validation"sv, chrono::steady_clock::now() - start, word_count);
+
+    word_count = 0;
+    vector<string_view> words;
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeat_count; ++r) {
+        if (!SplitIntoValidWords(text, words)) {
+            return;
+        }
+        word_count += words.size();
+    }
+    report("SplitIntoValidWords"sv, chrono::steady_clock::now() - start, word_count);
+}
+
+// Saves the index, maps it back and checks that it answers exactly like the in-memory build
+void CheckSnapshotRoundTrip(const SearchServer& search_server, const vector<string>& queries) {
+    const string path = "search_server.snapshot"s;
+    {
+        LOG_DURATION("snapshot save"s);
+        IndexSnapshot::Save(search_server, path);
+    }
+    {
+        LOG_DURATION("snapshot open"s);
+        IndexSnapshot snapshot(path, false);
+    }
+    IndexSnapshot snapshot(path);
+
+    int mismatch_count = 0;
+    for (const string& query : queries) {
+        const auto expected = search_server.FindTopDocuments(query);
+        const auto actual = snapshot.FindTopDocuments(query);
+        if (expected.size() != actual.size()
+            || !equal(expected.begin(), expected.end(), actual.begin(), [](const Document& lhs, const Document& rhs) {
+                   return lhs.id == rhs.id && lhs.relevance == rhs.relevance && lhs.rating == rhs.rating;
+               })) {
+            ++mismatch_count;
+        }
+    }
+    int checked_count = 0;
+    for (const int document_id : search_server) {
+        if (checked_count++ % 100 != 0) {
+            continue;
+        }
+        const string& query = queries[checked_count % queries.size()];
+        if (search_server.MatchDocument(query, document_id) != snapshot.MatchDocument(query, document_id)
+            || search_server.GetWordFrequencies(document_id) != snapshot.GetWordFrequencies(document_id)) {
+            ++mismatch_count;
+        }
+    }
+    cout << "snapshot round trip: "s << (mismatch_count == 0 ? "OK"s : to_string(mismatch_count) + " mismatches"s)
+         << endl;
+    remove(path.c_str());
+}
+
+// Runs the parallel query path split into a growing number of parts
+void BenchmarkParallelScaling(SearchServer& search_server, const vector<string>& queries) {
+    const size_t initial_thread_count = search_server.GetThreadCount();
+    for (size_t thread_count = 1; thread_count <= 16; thread_count *= 2) {
+        search_server.SetThreadCount(thread_count);
+        Test("par, "s + to_string(thread_count) + " threads"s, search_server, queries, execution::par);
+    }
+    search_server.SetThreadCount(initial_thread_count);
+}
+
+// Compares full scans of every term's postings stored as nested maps and as flat posting lists
+void BenchmarkPostingScan(const vector<string>& dictionary, const vector<string>& documents) {
+    map<string_view, map<int, double>> nested_index;
+    map<string_view, PostingList> flat_index;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        const auto words = SplitIntoWordsStringView(documents[i]);
+        const double inv_word_count = 1.0 / words.size();
+        map<string_view, double> word_freqs;
+        for (string_view word : words) {
+            word_freqs[word] += inv_word_count;
+        }
+        for (const auto [word, term_freq] : word_freqs) {
+            nested_index[word][i] = term_freq;
+            flat_index[word].Add(i, term_freq);
+        }
+    }
+
+    const int repeat_count = 20;
+    {
+        LOG_DURATION("posting scan, map<int, double>"s);
+        double total = 0;
+        for (int r = 0; r < repeat_count; ++r) {
+            for (const string& word : dictionary) {
+                auto it = nested_index.find(word);
+                if (it == nested_index.end()) {
+                    continue;
+                }
+                for (const auto [document_id, term_freq] : it->second) {
+                    total += term_freq * document_id;
+                }
+            }
+        }
+        cout << total << endl;
+    }
+    {
+        LOG_DURATION("posting scan, PostingList"s);
+        double total = 0;
+        for (int r = 0; r < repeat_count; ++r) {
+            for (const string& word : dictionary) {
+                auto it = flat_index.find(word);
+                if (it == flat_index.end()) {
+                    continue;
+                }
+                for (const auto [document_id, term_freq] : it->second) {
+                    total += term_freq * document_id;
+                }
+            }
+        }
+        cout << total << endl;
+    }
+
+    map<string_view, CompressedPostingList> compressed_index;
+    size_t posting_count = 0;
+    size_t flat_bytes = 0;
+    size_t compressed_bytes = 0;
+    for (const auto& [word, postings] : flat_index) {
+        const auto& compressed = compressed_index.emplace(word, CompressedPostingList(postings)).first->second;
+        posting_count += postings.size();
+        flat_bytes += postings.GetByteSize();
+        compressed_bytes += compressed.GetByteSize();
+    }
+    {
+        LOG_DURATION("posting scan, CompressedPostingList"s);
+        double total = 0;
+        for (int r = 0; r < repeat_count; ++r) {
+            for (const string& word : dictionary) {
+                auto it = compressed_index.find(word);
+                if (it == compressed_index.end()) {
+                    continue;
+                }
+                for (const auto [document_id, term_freq] : it->second) {
+                    total += term_freq * document_id;
+                }
+            }
+        }
+        cout << total << endl;
+    }
+    // A red-black tree node holds three pointers and a color besides the pair
+    const size_t map_node_bytes = sizeof(pair<const int, double>) + 4 * sizeof(void*);
+    cout << "bytes per posting: map<int, double> ~"s << map_node_bytes
+         << ", PostingList "s << flat_bytes * 1.0 / posting_count
+         << ", CompressedPostingList "s << compressed_bytes * 1.0 / posting_count << endl;
+}
+
+// Queries over the main index after packing its posting lists
+void BenchmarkCompressedPostings(SearchServer& search_server, const vector<string>& queries) {
+    const size_t flat_bytes = search_server.GetPostingByteSize();
+    search_server.SetPostingFormat(PostingFormat::COMPRESSED);
+    cout << "posting bytes: flat "s << flat_bytes << ", compressed "s << search_server.GetPostingByteSize() << endl;
+    Test("compressed seq"s, search_server, queries, execution::seq);
+    Test("compressed par"s, search_server, queries, execution::par);
+    search_server.SetPostingFormat(PostingFormat::FLAT);
+}
+
+// Removes a fifth of the corpus with queries in between, then compacts the rest
+void BenchmarkMassRemoval(const string& stop_words, const vector<string>& documents, const vector<string>& queries) {
+    SearchServer search_server(stop_words);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    search_server.SetCompactionThreshold(1.0);
+    {
+        LOG_DURATION("mass removal with queries"s);
+        for (size_t i = 0; i < documents.size(); i += 5) {
+            search_server.RemoveDocument(i);
+            if (i % 100 == 0) {
+                search_server.FindTopDocuments(queries[i / 100 % queries.size()]);
+            }
+        }
+    }
+    cout << search_server.GetPendingRemovalCount() << " removals pending"s << endl;
+    {
+        LOG_DURATION("compaction"s);
+        search_server.Compact();
+    }
+}
+
+// Removes most of the corpus one document at a time with the default compaction threshold,
+// the slowest call shows the longest stall a writer sees
+void BenchmarkRemovalLatency(const string& stop_words, const vector<string>& documents) {
+    SearchServer search_server(stop_words);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    chrono::steady_clock::duration total{};
+    chrono::steady_clock::duration slowest{};
+    for (size_t i = 0; i < documents.size(); i += 4) {
+        for (size_t j = i; j < min(i + 3, documents.size()); ++j) {
+            const auto start = chrono::steady_clock::now();
+            search_server.RemoveDocument(j);
+            const auto duration = chrono::steady_clock::now() - start;
+            total += duration;
+            slowest = max(slowest, duration);
+        }
+    }
+    cout << "removal: total "s << chrono::duration_cast<chrono::milliseconds>(total).count() << " ms, slowest "s
+         << chrono::duration_cast<chrono::microseconds>(slowest).count() << " us"s << endl;
+}
+
+// Every tenth document gets a copy with the same words in reverse order
+void BenchmarkRemoveDuplicates(const string& stop_words, const vector<string>& documents) {
+    for (int run = 0; run < 2; ++run) {
+        SearchServer search_server(stop_words);
+        int id = 0;
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(id++, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+            if (i % 10 == 0) {
+                const auto words = SplitIntoWordsView(documents[i]);
+                string copy;
+                for (auto it = words.rbegin(); it != words.rend(); ++it) {
+                    copy += static_cast<string>(*it) + " "s;
+                }
+                search_server.AddDocument(id++, copy, DocumentStatus::ACTUAL, {1, 2, 3});
+            }
+        }
+        vector<DuplicateGroup> groups;
+        {
+            LOG_DURATION("RemoveDuplicates"s);
+            groups = RemoveDuplicates(search_server);
+        }
+        size_t removed_count = 0;
+        for (const DuplicateGroup& group : groups) {
+            removed_count += group.duplicate_ids.size();
+        }
+        // A second call only looks at documents added in between
+        cout << groups.size() << " groups, "s << removed_count << " duplicates removed, "s
+             << RemoveDuplicates(search_server).size() << " on the next call"s << endl;
+    }
+}
+
+// Originals and copies with a few words replaced, added in shuffled id order. Recall is the share of pairs
+// with exact Jaccard similarity above the threshold that end up in one cluster
+void BenchmarkNearDuplicates(mt19937& generator, const vector<string>& dictionary) {
+    const int original_count = 2000;
+    const int word_count = 60;
+    vector<string> documents;
+    for (int i = 0; i < original_count; ++i) {
+        documents.push_back(GenerateQuery(generator, dictionary, word_count));
+    }
+    for (int i = 0; i < original_count / 2; ++i) {
+        auto words = SplitIntoWordsView(documents[uniform_int_distribution(0, original_count - 1)(generator)]);
+        const int replaced_count = uniform_int_distribution(0, 8)(generator);
+        for (int j = 0; j < replaced_count; ++j) {
+            words[uniform_int_distribution<int>(0, words.size() - 1)(generator)]
+                = dictionary[uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
+        }
+        string document;
+        for (const string& word : words) {
+            document += word + " "s;
+        }
+        documents.push_back(document);
+    }
+
+    SearchServer search_server(""s);
+    vector<vector<string_view>> word_sets;
+    vector<int> ids(documents.size());
+    iota(ids.begin(), ids.end(), 0);
+    shuffle(ids.begin(), ids.end(), generator);
+    for (const int id : ids) {
+        search_server.AddDocument(id, documents[id], DocumentStatus::ACTUAL, {1});
+    }
+    for (size_t i = 0; i < documents.size(); ++i) {
+        word_sets.emplace_back();
+        for (const auto& [word, _] : search_server.GetWordFrequencies(i)) {
+            word_sets.back().push_back(word);
+        }
+    }
+
+    for (double threshold : {0.7, 0.8, 0.9}) {
+        vector<vector<int>> clusters;
+        {
+            LOG_DURATION("FindNearDuplicates, threshold "s + to_string(threshold));
+            clusters = FindNearDuplicates(search_server, {threshold});
+        }
+        vector<int> cluster_of(documents.size(), -1);
+        for (size_t i = 0; i < clusters.size(); ++i) {
+            for (int id : clusters[i]) {
+                cluster_of[id] = i;
+            }
+        }
+        int pair_count = 0;
+        int found_count = 0;
+        for (size_t i = 0; i < word_sets.size(); ++i) {
+            for (size_t j = i + 1; j < word_sets.size(); ++j) {
+                vector<string_view> common;
+                set_intersection(word_sets[i].begin(), word_sets[i].end(), word_sets[j].begin(), word_sets[j].end(),
+                                 back_inserter(common));
+                const size_t union_size = word_sets[i].size() + word_sets[j].size() - common.size();
+                if (common.size() >= threshold * union_size) {
+                    ++pair_count;
+                    found_count += cluster_of[i] != -1 && cluster_of[i] == cluster_of[j];
+                }
+            }
+        }
+        const bool ordered = is_sorted(clusters.begin(), clusters.end())
+                             && all_of(clusters.begin(), clusters.end(), [](const vector<int>& cluster) {
+                                    return is_sorted(cluster.begin(), cluster.end());
+                                });
+        cout << clusters.size() << " clusters, recall "s << found_count << "/"s << pair_count
+             << (ordered ? ""s : ", ids out of order"s) << endl;
+    }
+}
+
+// Every thread increments random keys of a shared ConcurrentMap
+void BenchmarkConcurrentMap() {
+    const int key_count = 100'000;
+    const int ops_total = 2'000'000;
+    for (int thread_count = 1; thread_count <= 64; thread_count *= 2) {
+        ConcurrentMap<int, int> concurrent_map;
+        {
+            LOG_DURATION("ConcurrentMap, "s + to_string(thread_count) + " threads"s);
+            vector<future<void>> workers;
+            for (int t = 0; t < thread_count; ++t) {
+                workers.push_back(async(launch::async, [&concurrent_map, t, ops = ops_total / thread_count] {
+                    mt19937 generator(t);
+                    uniform_int_distribution<int> key_distribution(0, key_count - 1);
+                    for (int i = 0; i < ops; ++i) {
+                        ++concurrent_map[key_distribution(generator)].ref_to_value;
+                    }
+                }));
+            }
+            for (auto& worker : workers) {
+                worker.get();
+            }
+        }
+        cout << concurrent_map.BuildSortedVector().size() << " keys in "s
+             << concurrent_map.GetBucketCount() << " buckets"s << endl;
+    }
+}
+
 #define TEST(policy) Test(#policy, search_server, queries, execution::policy)
 
 int main() {
@@ -84,4 +817,27 @@ int main() {
 
     TEST(seq);
     TEST(par);
+    ReportQueryMetrics(search_server, queries);
+    BenchmarkMinusWords(generator, search_server, dictionary);
+    BenchmarkDynamicPruning(generator, search_server, dictionary);
+    BenchmarkResultCache(generator, search_server, dictionary);
+    BenchmarkStatusFilter(generator, dictionary, documents, queries);
+    BenchmarkDocumentFilter(dictionary[0], documents, queries);
+    BenchmarkParallelScaling(search_server, queries);
+    BenchmarkShardedSearchServer(dictionary[0], documents, queries);
+    BenchmarkThreadPool(search_server, queries);
+    BenchmarkQueryDeadlines(search_server, queries);
+    BenchmarkRequestQueue(search_server, queries);
+    StressVersionedSearchServer(dictionary[0], documents, queries);
+    BenchmarkBulkLoad(dictionary[0], documents);
+    CheckSnapshotRoundTrip(search_server, queries);
+    BenchmarkTokenizer(documents);
+    BenchmarkMassRemoval(dictionary[0], documents, queries);
+    BenchmarkRemovalLatency(dictionary[0], documents);
+    BenchmarkRemoveDuplicates(dictionary[0], documents);
+    BenchmarkNearDuplicates(generator, dictionary);
+
+    BenchmarkPostingScan(dictionary, documents);
+    BenchmarkCompressedPostings(search_server, queries);
+    BenchmarkConcurrentMap();
 }
\ No newline at end of file
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <cmath>
+#include "metrics.h"
+
+using namespace std;
+
+size_t GetMetricsStripeIndex() {
+    // Hashes of thread ids may collide, stripes handed out in turn do not until they run out
+    static atomic<size_t> next_index = 0;
+    thread_local const size_t index = next_index.fetch_add(1, memory_order_relaxed);
+    return index;
+}
+
+uint64_t MetricCounter::Get() const {
+    uint64_t total = 0;
+    for (const Stripe& stripe : stripes_) {
+        total += stripe.value.load(memory_order_relaxed);
+    }
+    return total;
+}
+
+void MetricCounter::Reset() {
+    for (Stripe& stripe : stripes_) {
+        stripe.value.store(0, memory_order_relaxed);
+    }
+}
+
+double HistogramSnapshot::GetMean() const {
+    return count == 0 ? 0.0 : static_cast<double>(sum) / count;
+}
+
+uint64_t HistogramSnapshot::GetPercentile(double percent) const {
+    if (count == 0) {
+        return 0;
+    }
+    const uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(ceil(count * percent / 100.0)));
+    uint64_t seen = 0;
+    for (const auto& [lower_bound, bucket_count] : buckets) {
+        seen += bucket_count;
+        if (seen >= rank) {
+            const size_t index = LatencyHistogram::GetBucketIndex(lower_bound);
+            if (index + 1 == LatencyHistogram::BUCKET_COUNT) {
+                return max_value;
+            }
+            return min(max_value, LatencyHistogram::GetBucketLowerBound(index + 1) - 1);
+        }
+    }
+    return max_value;
+}
+
+void LatencyHistogram::Record(uint64_t nanoseconds) {
+    Stripe& stripe = stripes_[GetMetricsStripeIndex() % STRIPE_COUNT];
+    stripe.buckets[GetBucketIndex(nanoseconds)].fetch_add(1, memory_order_relaxed);
+    stripe.sum.fetch_add(nanoseconds, memory_order_relaxed);
+    uint64_t current_max = stripe.max_value.load(memory_order_relaxed);
+    while (nanoseconds > current_max
+           && !stripe.max_value.compare_exchange_weak(current_max, nanoseconds, memory_order_relaxed)) {
+    }
+}
+
+HistogramSnapshot LatencyHistogram::GetSnapshot() const {
+    HistogramSnapshot snapshot;
+    for (size_t index = 0; index < BUCKET_COUNT; ++index) {
+        uint64_t bucket_count = 0;
+        for (const Stripe& stripe : stripes_) {
+            bucket_count += stripe.buckets[index].load(memory_order_relaxed);
+        }
+        if (bucket_count != 0) {
+            snapshot.buckets.push_back({GetBucketLowerBound(index), bucket_count});
+            snapshot.count += bucket_count;
+        }
+    }
+    // Count follows the buckets, so percentiles agree with it even under concurrent updates
+    for (const Stripe& stripe : stripes_) {
+        snapshot.sum += stripe.sum.load(memory_order_relaxed);
+        snapshot.max_value = max(snapshot.max_value, stripe.max_value.load(memory_order_relaxed));
+    }
+    return snapshot;
+}
+
+void LatencyHistogram::Reset() {
+    for (Stripe& stripe : stripes_) {
+        for (atomic<uint64_t>& bucket : stripe.buckets) {
+            bucket.store(0, memory_order_relaxed);
+        }
+        stripe.sum.store(0, memory_order_relaxed);
+        stripe.max_value.store(0, memory_order_relaxed);
+    }
+}
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return value;
+    }
+    int exponent = 63;
+    while (!(value >> exponent)) {
+        --exponent;
+    }
+    const size_t sub_bucket = (value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1);
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + sub_bucket;
+}
+
+uint64_t LatencyHistogram::GetBucketLowerBound(size_t index) {
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    const int exponent = static_cast<int>(index / SUB_BUCKET_COUNT) + SUB_BUCKET_BITS - 1;
+    const uint64_t sub_bucket = index % SUB_BUCKET_COUNT;
+    return (SUB_BUCKET_COUNT + sub_bucket) << (exponent - SUB_BUCKET_BITS);
+}
+
+ostream& operator<<(ostream& out, const MetricsSnapshot& snapshot) {
+    for (const auto& [name, value] : snapshot.counters) {
+        out << name << " "s << value << "\n"s;
+    }
+    for (const auto& [name, histogram] : snapshot.histograms) {
+        out << name << " count="s << histogram.count
+            << " mean_us="s << histogram.GetMean() / 1000.0
+            << " p50_us="s << histogram.GetPercentile(50) / 1000.0
+            << " p90_us="s << histogram.GetPercentile(90) / 1000.0
+            << " p99_us="s << histogram.GetPercentile(99) / 1000.0
+            << " max_us="s << histogram.max_value / 1000.0 << "\n"s;
+    }
+    return out;
+}
+
+MetricsRegistry& MetricsRegistry::Instance() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricCounter& MetricsRegistry::GetCounter(const string& name) {
+    lock_guard guard(guard_);
+    auto& counter = counters_[name];
+    if (!counter) {
+        counter = make_unique<MetricCounter>();
+    }
+    return *counter;
+}
+
+LatencyHistogram& MetricsRegistry::GetHistogram(const string& name) {
+    lock_guard guard(guard_);
+    auto& histogram = histograms_[name];
+    if (!histogram) {
+        histogram = make_unique<LatencyHistogram>();
+    }
+    return *histogram;
+}
+
+MetricsSnapshot MetricsRegistry::GetSnapshot() const {
+    lock_guard guard(guard_);
+    MetricsSnapshot snapshot;
+    for (const auto& [name, counter] : counters_) {
+        snapshot.counters[name] = counter->Get();
+    }
+    for (const auto& [name, histogram] : histograms_) {
+        snapshot.histograms[name] = histogram->GetSnapshot();
+    }
+    return snapshot;
+}
+
+void MetricsRegistry::Reset() {
+    lock_guard guard(guard_);
+    for (auto& [_, counter] : counters_) {
+        counter->Reset();
+    }
+    for (auto& [_, histogram] : histograms_) {
+        histogram->Reset();
+    }
+}
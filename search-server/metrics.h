@@ -0,0 +1,148 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Build with -DSEARCH_SERVER_METRICS=0 to compile the instrumentation out
+#ifndef SEARCH_SERVER_METRICS
+#define SEARCH_SERVER_METRICS 1
+#endif
+
+// Stripe of the calling thread. Threads get stripes in turn, so up to STRIPE_COUNT of them never share one
+size_t GetMetricsStripeIndex();
+
+// Sum of non-negative increments. Threads add to different cache lines and Get adds them up
+class MetricCounter {
+public:
+    static constexpr size_t STRIPE_COUNT = 8;
+
+    void Add(uint64_t value = 1) {
+        stripes_[GetMetricsStripeIndex() % STRIPE_COUNT].value.fetch_add(value, memory_order_relaxed);
+    }
+
+    uint64_t Get() const;
+    void Reset();
+
+private:
+    struct alignas(64) Stripe {
+        atomic<uint64_t> value = 0;
+    };
+
+    array<Stripe, STRIPE_COUNT> stripes_;
+};
+
+struct HistogramSnapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max_value = 0;
+    vector<pair<uint64_t, uint64_t>> buckets; // Non-empty ones as lower bound and count, ascending
+
+    double GetMean() const;
+
+    // Upper bound of the bucket holding the nearest-rank percentile, never above max
+    uint64_t GetPercentile(double percent) const;
+};
+
+// Log-linear histogram of nanoseconds: every power of two is split into SUB_BUCKET_COUNT
+// equal buckets, so a value is known within 12.5% over the whole uint64_t range.
+// Striped like MetricCounter, GetSnapshot adds the stripes up
+class LatencyHistogram {
+public:
+    static constexpr size_t STRIPE_COUNT = MetricCounter::STRIPE_COUNT;
+    static constexpr int SUB_BUCKET_BITS = 3;
+    static constexpr size_t SUB_BUCKET_COUNT = size_t{1} << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    void Record(uint64_t nanoseconds);
+
+    HistogramSnapshot GetSnapshot() const;
+    void Reset();
+
+    static size_t GetBucketIndex(uint64_t value);
+    static uint64_t GetBucketLowerBound(size_t index);
+
+private:
+    struct alignas(64) Stripe {
+        array<atomic<uint64_t>, BUCKET_COUNT> buckets{};
+        atomic<uint64_t> sum = 0;
+        atomic<uint64_t> max_value = 0;
+    };
+
+    array<Stripe, STRIPE_COUNT> stripes_;
+};
+
+struct MetricsSnapshot {
+    map<string, uint64_t> counters;
+    map<string, HistogramSnapshot> histograms;
+};
+
+// One line per metric, latencies in microseconds
+ostream& operator<<(ostream& out, const MetricsSnapshot& snapshot);
+
+// Process-wide metrics by name. Returned references stay valid for the whole run
+class MetricsRegistry {
+public:
+    static MetricsRegistry& Instance();
+
+    MetricCounter& GetCounter(const string& name);
+    LatencyHistogram& GetHistogram(const string& name);
+
+    // Metrics updated meanwhile may be caught in the middle of an update
+    MetricsSnapshot GetSnapshot() const;
+
+    // Zeroes every metric, registered names stay
+    void Reset();
+
+private:
+    mutable mutex guard_;
+    map<string, unique_ptr<MetricCounter>, less<>> counters_;
+    map<string, unique_ptr<LatencyHistogram>, less<>> histograms_;
+};
+
+// Records the time from construction to destruction
+class ScopedLatency {
+public:
+    using Clock = chrono::steady_clock;
+
+    explicit ScopedLatency(LatencyHistogram& histogram)
+        : histogram_(histogram) {
+    }
+
+    ~ScopedLatency() {
+        histogram_.Record(chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start_time_).count());
+    }
+
+private:
+    LatencyHistogram& histogram_;
+    const Clock::time_point start_time_ = Clock::now();
+};
+
+#define METRICS_CONCAT_INTERNAL(X, Y) X##Y
+#define METRICS_CONCAT(X, Y) METRICS_CONCAT_INTERNAL(X, Y)
+
+// The metric is looked up once per call site
+#if SEARCH_SERVER_METRICS
+#define METRICS_COUNT(name, value)                                                                \
+    do {                                                                                          \
+        static MetricCounter& metrics_counter = MetricsRegistry::Instance().GetCounter(name);     \
+        metrics_counter.Add(value);                                                               \
+    } while (false)
+#define METRICS_LATENCY(name)                                                                     \
+    static LatencyHistogram& METRICS_CONCAT(metricsHistogram, __LINE__) =                         \
+        MetricsRegistry::Instance().GetHistogram(name);                                           \
+    ScopedLatency METRICS_CONCAT(metricsLatency, __LINE__)(METRICS_CONCAT(metricsHistogram, __LINE__))
+#else
+#define METRICS_COUNT(name, value) do {} while (false)
+#define METRICS_LATENCY(name) do {} while (false)
+#endif
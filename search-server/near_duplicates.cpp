@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <execution>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string_view>
+#include "fingerprint.h"
+#include "near_duplicates.h"
+
+using namespace std;
+
+namespace {
+
+// Only the top 16 bits of every minimum are kept, two different minimums collide with this probability
+const double SIGNATURE_COLLISION = 1.0 / 65536;
+
+size_t ChooseBandCount(double threshold, size_t hash_count) {
+    // The longest bands give the fewest false candidates, shorten them until recall is high enough
+    for (size_t rows = hash_count; rows > 1; --rows) {
+        const size_t bands = hash_count / rows;
+        if (1.0 - pow(1.0 - pow(threshold, rows), bands) >= 0.95) {
+            return bands;
+        }
+    }
+    return hash_count;
+}
+
+class DisjointSets {
+public:
+    explicit DisjointSets(size_t size)
+        : parents_(size) {
+        iota(parents_.begin(), parents_.end(), 0);
+    }
+
+    uint32_t Find(uint32_t element) {
+        while (parents_[element] != element) {
+            parents_[element] = parents_[parents_[element]];
+            element = parents_[element];
+        }
+        return element;
+    }
+
+    void Unite(uint32_t lhs, uint32_t rhs) {
+        lhs = Find(lhs);
+        rhs = Find(rhs);
+        if (lhs != rhs) {
+            parents_[max(lhs, rhs)] = min(lhs, rhs);
+        }
+    }
+
+private:
+    vector<uint32_t> parents_;
+};
+
+} // namespace
+
+vector<vector<int>> FindNearDuplicates(const SearchServer& search_server, const NearDuplicateOptions& options) {
+    if (options.jaccard_threshold <= 0.0 || options.jaccard_threshold > 1.0 || options.hash_count == 0) {
+        throw invalid_argument("Invalid near duplicate options"s);
+    }
+    const size_t hash_count = options.hash_count;
+    const size_t band_count = options.band_count == 0
+                              ? ChooseBandCount(options.jaccard_threshold, hash_count)
+                              : min(options.band_count, hash_count);
+    const size_t rows = hash_count / band_count;
+
+    // Ascending ids make the smallest index of a cluster its smallest id
+    vector<int> ids(search_server.begin(), search_server.end());
+    sort(ids.begin(), ids.end());
+    const size_t document_count = ids.size();
+
+    // Multiply-shift hash functions over one 64-bit hash of a word
+    vector<uint64_t> multipliers(hash_count);
+    for (size_t i = 0; i < hash_count; ++i) {
+        multipliers[i] = MixBits(i + 1) | 1;
+    }
+
+    // b-bit MinHash keeps signatures of millions of documents in a few hundred bytes each
+    vector<uint16_t> signatures(document_count * hash_count);
+    ThreadPool& thread_pool = search_server.GetThreadPool();
+    thread_pool.ParallelFor(document_count, [&](size_t index) {
+        vector<uint64_t> minimums(hash_count, numeric_limits<uint64_t>::max());
+        for (const auto& [word, _] : search_server.GetWordFrequencies(ids[index])) {
+            const uint64_t word_hash = MixBits(hash<string_view>{}(word));
+            for (size_t i = 0; i < hash_count; ++i) {
+                minimums[i] = min(minimums[i], multipliers[i] * word_hash);
+            }
+        }
+        uint16_t* signature = &signatures[index * hash_count];
+        for (size_t i = 0; i < hash_count; ++i) {
+            signature[i] = static_cast<uint16_t>(minimums[i] >> 48);
+        }
+    });
+
+    auto estimate_similarity = [&](uint32_t lhs, uint32_t rhs) {
+        const uint16_t* lhs_signature = &signatures[lhs * hash_count];
+        const uint16_t* rhs_signature = &signatures[rhs * hash_count];
+        size_t equal_count = 0;
+        for (size_t i = 0; i < hash_count; ++i) {
+            equal_count += lhs_signature[i] == rhs_signature[i];
+        }
+        return (equal_count * 1.0 / hash_count - SIGNATURE_COLLISION) / (1.0 - SIGNATURE_COLLISION);
+    };
+    // The estimate only rejects pairs far below the threshold, the rest are compared exactly
+    const double threshold = options.jaccard_threshold;
+    const double estimate_margin = 4.0 * sqrt(threshold * (1.0 - threshold) / hash_count);
+    auto is_similar = [&](uint32_t lhs, uint32_t rhs) {
+        if (estimate_similarity(lhs, rhs) < threshold - estimate_margin) {
+            return false;
+        }
+        const auto lhs_words = search_server.GetWordFrequencies(ids[lhs]);
+        const auto rhs_words = search_server.GetWordFrequencies(ids[rhs]);
+        size_t common_count = 0;
+        for (auto lhs_it = lhs_words.begin(), rhs_it = rhs_words.begin();
+             lhs_it != lhs_words.end() && rhs_it != rhs_words.end();) {
+            if (lhs_it->first < rhs_it->first) {
+                ++lhs_it;
+            } else if (rhs_it->first < lhs_it->first) {
+                ++rhs_it;
+            } else {
+                ++common_count;
+                ++lhs_it;
+                ++rhs_it;
+            }
+        }
+        const size_t union_size = lhs_words.size() + rhs_words.size() - common_count;
+        return common_count >= threshold * union_size;
+    };
+
+    // Bands are processed one at a time, so only one table of band keys is alive
+    DisjointSets clusters(document_count);
+    vector<pair<uint64_t, uint32_t>> band_keys(document_count);
+    for (size_t band = 0; band < band_count; ++band) {
+        thread_pool.ParallelFor(document_count, [&](size_t index) {
+            FingerprintBuilder builder;
+            const uint16_t* signature = &signatures[index * hash_count + band * rows];
+            for (size_t row = 0; row < rows; ++row) {
+                builder.Add(signature[row]);
+            }
+            band_keys[index] = {builder.Get().low, static_cast<uint32_t>(index)};
+        });
+        sort(execution::par, band_keys.begin(), band_keys.end());
+
+        for (auto first = band_keys.begin(); first != band_keys.end();) {
+            auto last = find_if(first, band_keys.end(), [first](const auto& key) {
+                return key.first != first->first;
+            });
+            // Every member is checked against one representative of each cluster already in the bucket
+            vector<uint32_t> representatives;
+            for (auto it = first; it != last; ++it) {
+                const uint32_t index = it->second;
+                bool clustered = false;
+                for (uint32_t representative : representatives) {
+                    if (clusters.Find(representative) == clusters.Find(index)
+                        || is_similar(representative, index)) {
+                        clusters.Unite(representative, index);
+                        clustered = true;
+                        break;
+                    }
+                }
+                if (!clustered) {
+                    representatives.push_back(index);
+                }
+            }
+            first = last;
+        }
+    }
+
+    // Roots are the smallest members and indexes follow ascending ids
+    vector<vector<int>> result;
+    vector<uint32_t> cluster_by_root(document_count, numeric_limits<uint32_t>::max());
+    for (uint32_t index = 0; index < document_count; ++index) {
+        const uint32_t root = clusters.Find(index);
+        if (root == index) {
+            continue;
+        }
+        if (cluster_by_root[root] == numeric_limits<uint32_t>::max()) {
+            cluster_by_root[root] = static_cast<uint32_t>(result.size());
+            result.push_back({ids[root]});
+        }
+        result[cluster_by_root[root]].push_back(ids[index]);
+    }
+    sort(result.begin(), result.end());
+    return result;
+}
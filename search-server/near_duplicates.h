@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "search_server.h"
+
+using namespace std;
+
+struct NearDuplicateOptions {
+    // Documents whose word sets have at least this Jaccard similarity are clustered together
+    double jaccard_threshold = 0.8;
+    // MinHash functions per document, every one costs two bytes of signature
+    size_t hash_count = 128;
+    // LSH bands, zero picks them for at least 95% candidate probability at the threshold
+    size_t band_count = 0;
+};
+
+// Clusters stored documents of the server by MinHash signatures of their word sets.
+// Candidates come from LSH bands, the estimated similarity filters them before an exact check.
+// Returns clusters of two or more ids, ids ascending, clusters ordered by their first id
+vector<vector<int>> FindNearDuplicates(const SearchServer& search_server,
+                                       const NearDuplicateOptions& options = {});
@@ -0,0 +1,88 @@
+#include <vector>
+#include <algorithm>
+#include "posting_list.h"
+
+using namespace std;
+
+void PostingList::Add(uint32_t ordinal, double term_freq) {
+    if (postings_.empty() || postings_.back().ordinal < ordinal) {
+        postings_.push_back({ordinal, term_freq});
+        return;
+    }
+    auto it = LowerBound(ordinal);
+    auto pos = postings_.begin() + distance(postings_.cbegin(), it);
+    if (pos != postings_.end() && pos->ordinal == ordinal) {
+        pos->term_freq += term_freq;
+    } else {
+        postings_.insert(pos, {ordinal, term_freq});
+    }
+}
+
+bool PostingList::Remove(uint32_t ordinal) {
+    auto it = LowerBound(ordinal);
+    if (it == postings_.cend() || it->ordinal != ordinal) {
+        return false;
+    }
+    postings_.erase(it);
+    return true;
+}
+
+const Posting* PostingList::Find(uint32_t ordinal) const {
+    auto it = LowerBound(ordinal);
+    if (it == postings_.cend() || it->ordinal != ordinal) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+bool PostingList::Contains(uint32_t ordinal) const {
+    return Find(ordinal) != nullptr;
+}
+
+PostingList::const_iterator PostingList::LowerBound(uint32_t ordinal) const {
+    return lower_bound(postings_.cbegin(), postings_.cend(), ordinal,
+                       [](const Posting& lhs, uint32_t value) { return lhs.ordinal < value; });
+}
+
+PostingList::const_iterator PostingList::LowerBound(const_iterator first, uint32_t ordinal) const {
+    auto less = [](const Posting& lhs, uint32_t value) { return lhs.ordinal < value; };
+    const auto last = postings_.cend();
+    size_t step = 1;
+    while (first != last && first->ordinal < ordinal) {
+        if (step >= static_cast<size_t>(last - first)) {
+            return lower_bound(first + 1, last, ordinal, less);
+        }
+        if (first[step].ordinal >= ordinal) {
+            return lower_bound(first + 1, first + step, ordinal, less);
+        }
+        first += step;
+        step *= 2;
+    }
+    return first;
+}
+
+PostingList::const_iterator PostingList::begin() const {
+    return postings_.cbegin();
+}
+
+PostingList::const_iterator PostingList::end() const {
+    return postings_.cend();
+}
+
+size_t PostingList::size() const {
+    return postings_.size();
+}
+
+bool PostingList::empty() const {
+    return postings_.empty();
+}
+
+size_t PostingList::GetByteSize() const {
+    return postings_.capacity() * sizeof(Posting);
+}
+
+void PostingList::Renumber(const vector<uint32_t>& new_ordinals) {
+    for (Posting& posting : postings_) {
+        posting.ordinal = new_ordinals[posting.ordinal];
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+struct Posting {
+    uint32_t ordinal;
+    double term_freq;
+};
+
+// Contiguous list of postings of one term sorted by document ordinal.
+// Documents get growing ordinals, so Add is an append in the common case.
+class PostingList {
+public:
+    using const_iterator = vector<Posting>::const_iterator;
+
+    // Adds term_freq to the posting of the document, creating it if needed
+    void Add(uint32_t ordinal, double term_freq);
+
+    // Returns false if there was no posting for the document
+    bool Remove(uint32_t ordinal);
+
+    // Erases postings whose ordinal matches the predicate, returns the number erased
+    template <typename Predicate>
+    size_t RemoveIf(Predicate predicate);
+
+    // Replaces every ordinal with new_ordinals[ordinal], the mapping must keep the order of the list
+    void Renumber(const vector<uint32_t>& new_ordinals);
+
+    // nullptr if the document has no posting
+    const Posting* Find(uint32_t ordinal) const;
+
+    bool Contains(uint32_t ordinal) const;
+
+    // First posting with ordinal not less than the given one
+    const_iterator LowerBound(uint32_t ordinal) const;
+    // Same, searching from first on by galloping, so short skips cost little
+    const_iterator LowerBound(const_iterator first, uint32_t ordinal) const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    size_t size() const;
+    bool empty() const;
+
+    // Heap memory held by the list
+    size_t GetByteSize() const;
+
+private:
+    vector<Posting> postings_;
+};
+
+template <typename Predicate>
+size_t PostingList::RemoveIf(Predicate predicate) {
+    const size_t initial_size = postings_.size();
+    postings_.erase(remove_if(postings_.begin(), postings_.end(),
+                              [&predicate](const Posting& posting) { return predicate(posting.ordinal); }),
+                    postings_.end());
+    return initial_size - postings_.size();
+}
@@ -15,10 +15,10 @@ std::vector<std::vector<Document>> ProcessQueries(
     
     std::vector<std::vector<Document>> documents_lists(queries.size());
     
-    std::transform(std::execution::par,
-        queries.begin(), queries.end(),
-        documents_lists.begin(),
-        [&search_server](const auto& query){ return search_server.FindTopDocuments(query); });
+    // Queries run on the server's pool, parallel queries inside it share the same workers
+    search_server.GetThreadPool().ParallelFor(queries.size(), [&](size_t index) {
+        documents_lists[index] = search_server.FindTopDocuments(queries[index]);
+    });
     
     return documents_lists;
 }
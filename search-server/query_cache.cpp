@@ -0,0 +1,98 @@
+#include <functional>
+#include "query_cache.h"
+
+using namespace std;
+
+QueryCache::QueryCache(size_t capacity) {
+    SetCapacity(capacity);
+}
+
+QueryCache::QueryCache(const QueryCache& other) {
+    SetCapacity(other.capacity_);
+}
+
+QueryCache& QueryCache::operator=(const QueryCache& other) {
+    if (this != &other) {
+        SetCapacity(other.capacity_);
+    }
+    return *this;
+}
+
+optional<vector<Document>> QueryCache::Find(const string& key, uint64_t generation) {
+    Shard& shard = GetShard(key);
+    {
+        lock_guard guard(shard.guard);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            if (it->second->generation == generation) {
+                shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+                hits_.fetch_add(1, memory_order_relaxed);
+                return it->second->documents;
+            }
+            // Computed before the corpus changed
+            auto entry = it->second;
+            shard.index.erase(it);
+            shard.entries.erase(entry);
+        }
+    }
+    misses_.fetch_add(1, memory_order_relaxed);
+    return nullopt;
+}
+
+void QueryCache::Insert(const string& key, uint64_t generation, const vector<Document>& documents) {
+    Shard& shard = GetShard(key);
+    if (shard.capacity == 0) {
+        return;
+    }
+    lock_guard guard(shard.guard);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        // Another reader computed the same query meanwhile
+        it->second->generation = generation;
+        it->second->documents = documents;
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        return;
+    }
+    if (shard.entries.size() == shard.capacity) {
+        shard.index.erase(shard.entries.back().key);
+        shard.entries.pop_back();
+    }
+    shard.entries.push_front({key, generation, documents});
+    shard.index.emplace(shard.entries.front().key, shard.entries.begin());
+}
+
+void QueryCache::SetCapacity(size_t capacity) {
+    capacity_ = capacity;
+    for (size_t i = 0; i < SHARD_COUNT; ++i) {
+        // Shard capacities add up to the total exactly
+        shards_[i].capacity = capacity / SHARD_COUNT + (i < capacity % SHARD_COUNT ? 1 : 0);
+    }
+    Clear();
+}
+
+size_t QueryCache::GetCapacity() const {
+    return capacity_;
+}
+
+void QueryCache::Clear() {
+    for (Shard& shard : shards_) {
+        lock_guard guard(shard.guard);
+        shard.index.clear();
+        shard.entries.clear();
+    }
+}
+
+QueryCache::Statistics QueryCache::GetStatistics() const {
+    Statistics statistics;
+    statistics.hits = hits_.load(memory_order_relaxed);
+    statistics.misses = misses_.load(memory_order_relaxed);
+    for (const Shard& shard : shards_) {
+        lock_guard guard(const_cast<mutex&>(shard.guard));
+        statistics.size += shard.entries.size();
+    }
+    return statistics;
+}
+
+QueryCache::Shard& QueryCache::GetShard(const string& key) {
+    return shards_[hash<string>{}(key) % SHARD_COUNT];
+}
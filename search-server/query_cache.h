@@ -0,0 +1,71 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "document.h"
+
+using namespace std;
+
+// LRU cache of query results split into independently locked shards, safe for concurrent readers.
+// Every entry remembers the corpus generation it was computed for, older entries are misses.
+class QueryCache {
+public:
+    struct Statistics {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t size = 0;
+    };
+
+    // Zero capacity disables the cache
+    explicit QueryCache(size_t capacity = 0);
+
+    // Copies the capacity only, entries and counters start empty
+    QueryCache(const QueryCache& other);
+    QueryCache& operator=(const QueryCache& other);
+
+    bool IsEnabled() const {
+        return capacity_ != 0;
+    }
+
+    optional<vector<Document>> Find(const string& key, uint64_t generation);
+    void Insert(const string& key, uint64_t generation, const vector<Document>& documents);
+
+    // Not safe while queries are running
+    void SetCapacity(size_t capacity);
+    size_t GetCapacity() const;
+
+    void Clear();
+
+    Statistics GetStatistics() const;
+
+private:
+    static const size_t SHARD_COUNT = 16;
+
+    struct Entry {
+        string key;
+        uint64_t generation;
+        vector<Document> documents;
+    };
+
+    struct alignas(64) Shard {
+        mutex guard;
+        list<Entry> entries; // Most recently used first
+        unordered_map<string_view, list<Entry>::iterator> index; // Keys point into entries
+        size_t capacity = 0;
+    };
+
+    size_t capacity_ = 0;
+    array<Shard, SHARD_COUNT> shards_;
+    atomic<uint64_t> hits_ = 0;
+    atomic<uint64_t> misses_ = 0;
+
+    Shard& GetShard(const string& key);
+};
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <vector>
 #include "search_server.h"
 
 using namespace std;
 
-void RemoveDuplicates(SearchServer& search_server);
+// Removes documents with the same set of words as an earlier original and returns them grouped.
+// Only documents added since the previous call on this server are checked
+vector<DuplicateGroup> RemoveDuplicates(SearchServer& search_server);
@@ -1,5 +1,5 @@
 #include <vector>
-#include <deque>
+#include <algorithm>
 #include "request_queue.h"
 #include "document.h"
 
@@ -11,39 +11,66 @@ RequestQueue::RequestQueue(const SearchServer& search_server)
     }
 
 vector<Document> RequestQueue::AddFindRequest(const string& raw_query, DocumentStatus status) {
-    StepForNewRequest();
-    vector<Document> result = search_server_.FindTopDocuments(raw_query, status);
-    StepAfterRequest(result);
-    return result;
+    return AddRequest([&]() {
+        return search_server_.FindTopDocuments(raw_query, status);
+    });
 }
 
 vector<Document> RequestQueue::AddFindRequest(const string& raw_query) {
-    StepForNewRequest();
-    vector<Document> result = search_server_.FindTopDocuments(raw_query);
-    StepAfterRequest(result);
-    return result;
+    return AddRequest([&]() {
+        return search_server_.FindTopDocuments(raw_query);
+    });
 }
 
 int RequestQueue::GetNoResultRequests() const {
-    return empty_requests_;
+    return empty_requests_.load(memory_order_relaxed);
 }
 
-void RequestQueue::StepForNewRequest() {
-    ++now_time;
-    if (now_time > min_in_day_ || requests_.size() >= min_in_day_) {
-        if ((requests_.front()).empty_result) {
-            --empty_requests_;
+RequestQueue::Statistics RequestQueue::GetStatistics() const {
+    Statistics statistics;
+    vector<uint64_t> latencies;
+    latencies.reserve(min_in_day_);
+    for (const atomic<Record>& slot : requests_) {
+        const Record record = slot.load(memory_order_relaxed);
+        if (!(record & OCCUPIED_BIT)) {
+            continue;
         }
-        requests_.pop_front();
+        if (record & EMPTY_BIT) {
+            ++statistics.no_result_count;
+        }
+        latencies.push_back(record & MAX_LATENCY);
+    }
+    statistics.request_count = latencies.size();
+    if (latencies.empty()) {
+        return statistics;
     }
+    statistics.no_result_rate = static_cast<double>(statistics.no_result_count) / latencies.size();
+
+    sort(latencies.begin(), latencies.end());
+    // Nearest-rank percentile
+    auto percentile = [&latencies](size_t percent) {
+        const size_t rank = (latencies.size() * percent + 99) / 100;
+        return chrono::microseconds(latencies[max<size_t>(rank, 1) - 1]);
+    };
+    statistics.latency_p50 = percentile(50);
+    statistics.latency_p90 = percentile(90);
+    statistics.latency_p99 = percentile(99);
+    statistics.latency_max = chrono::microseconds(latencies.back());
+    return statistics;
 }
-    
-void RequestQueue::StepAfterRequest(const vector<Document>& result) {
-    bool empty_result = !!(result.empty());
-    if (empty_result) {
-        ++empty_requests_;
+
+void RequestQueue::StepAfterRequest(const vector<Document>& result, chrono::steady_clock::duration latency) {
+    const uint64_t microseconds = chrono::duration_cast<chrono::microseconds>(latency).count();
+    Record record = OCCUPIED_BIT | min<uint64_t>(microseconds, MAX_LATENCY)
+                    | min<uint64_t>(result.size(), MAX_RESULT_COUNT) << RESULT_COUNT_SHIFT;
+    if (result.empty()) {
+        record |= EMPTY_BIT;
+    }
+    // The new request takes the place of the oldest one in the window
+    const uint64_t index = request_count_.fetch_add(1, memory_order_relaxed);
+    const Record evicted = requests_[index % min_in_day_].exchange(record, memory_order_relaxed);
+    const int empty_delta = ((record & EMPTY_BIT) ? 1 : 0) - ((evicted & EMPTY_BIT) ? 1 : 0);
+    if (empty_delta != 0) {
+        empty_requests_.fetch_add(empty_delta, memory_order_relaxed);
     }
-    QueryResult request = {result, empty_result};
-    requests_.push_back(request);
 }
-    
\ No newline at end of file
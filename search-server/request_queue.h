@@ -1,14 +1,30 @@
 #pragma once
 #include <vector>
 #include <string>
-#include <deque>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include "document.h"
 #include "search_server.h"
 
 using namespace std;
 
+// Remembers the last min_in_day_ requests as compact records in a ring buffer.
+// Requests may be added from several threads, statistics may be read meanwhile
 class RequestQueue {
 public:
+    // Over the requests currently in the window
+    struct Statistics {
+        size_t request_count = 0;
+        size_t no_result_count = 0;
+        double no_result_rate = 0.0;
+        chrono::microseconds latency_p50{0};
+        chrono::microseconds latency_p90{0};
+        chrono::microseconds latency_p99{0};
+        chrono::microseconds latency_max{0};
+    };
+
     explicit RequestQueue(const SearchServer& search_server);
 
     template <typename DocumentPredicate>
@@ -19,29 +35,44 @@ public:
     vector<Document> AddFindRequest(const string& raw_query);
 
     int GetNoResultRequests() const;
-    
+
+    // Records written while the window is read may land in either state
+    Statistics GetStatistics() const;
+
 private:
-    
-    struct QueryResult {
-        vector<Document> result;
-        bool empty_result;
-    };
-    
-    deque<QueryResult> requests_;
+    // One word per request so that it is written and read atomically
+    // [63] occupied, [48] empty result, [32..47] result count, [0..31] latency in microseconds
+    using Record = uint64_t;
+
+    static constexpr Record OCCUPIED_BIT = uint64_t{1} << 63;
+    static constexpr Record EMPTY_BIT = uint64_t{1} << 48;
+    static constexpr int RESULT_COUNT_SHIFT = 32;
+    static constexpr uint64_t MAX_RESULT_COUNT = 0xFFFF;
+    static constexpr uint64_t MAX_LATENCY = 0xFFFFFFFF;
+
     const static int min_in_day_ = 1440;
-    int now_time = 0;
     const SearchServer& search_server_;
-    int empty_requests_ = 0;
-    
-    void StepForNewRequest();
-    
-    void StepAfterRequest(const vector<Document>& result);
+    array<atomic<Record>, min_in_day_> requests_{};
+    atomic<uint64_t> request_count_ = 0;
+    atomic<int> empty_requests_ = 0;
+
+    template <typename Search>
+    vector<Document> AddRequest(Search search);
+
+    void StepAfterRequest(const vector<Document>& result, chrono::steady_clock::duration latency);
 };
 
+template <typename Search>
+vector<Document> RequestQueue::AddRequest(Search search) {
+    const auto start_time = chrono::steady_clock::now();
+    vector<Document> result = search();
+    StepAfterRequest(result, chrono::steady_clock::now() - start_time);
+    return result;
+}
+
 template <typename DocumentPredicate>
 vector<Document> RequestQueue::AddFindRequest(const string& raw_query, DocumentPredicate document_predicate) {
-    StepForNewRequest();
-    vector<Document> result = search_server_.FindTopDocuments(raw_query, document_predicate);
-    StepAfterRequest(result);
-    return result;
-}
\ No newline at end of file
+    return AddRequest([&]() {
+        return search_server_.FindTopDocuments(raw_query, document_predicate);
+    });
+}
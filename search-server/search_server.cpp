@@ -5,6 +5,9 @@
 #include <stdexcept>
 #include <numeric>
 #include <functional>
+#include <execution>
+#include <limits>
+#include <unordered_map>
 #include "document.h"
 #include "search_server.h"
 #include "string_processing.h"
@@ -34,29 +37,512 @@ int SearchServer::GetDocumentCount() const {
     return documents_.size();
 }
 
+future<QueryResult> SearchServer::SubmitQuery(string raw_query, Deadline deadline, DocumentStatus status) const {
+    return SubmitQuery(move(raw_query), deadline, StatusPredicate{status});
+}
+
+future<void> SearchServer::SubmitQuery(string raw_query, Deadline deadline, DocumentStatus status,
+                                       function<void(QueryResult)> callback) const {
+    return thread_pool_->Submit([this, raw_query = move(raw_query), deadline, status, callback = move(callback)]() {
+        callback(FindTopDocumentsUntil(raw_query, deadline, status));
+    });
+}
+
+void SearchServer::SetMaxResultDocumentCount(size_t count) {
+    max_result_document_count_ = count;
+    // Cached results were cut to the previous count
+    result_cache_.Clear();
+}
+
+size_t SearchServer::GetMaxResultDocumentCount() const {
+    return max_result_document_count_;
+}
+
+void SearchServer::SetThreadCount(size_t count) {
+    thread_count_ = count;
+}
+
+size_t SearchServer::GetThreadCount() const {
+    return thread_count_ != 0 ? thread_count_ : thread_pool_->GetWorkerCount();
+}
+
+void SearchServer::SetThreadPool(shared_ptr<ThreadPool> thread_pool) {
+    if (!thread_pool) {
+        throw invalid_argument("Thread pool must not be null"s);
+    }
+    thread_pool_ = move(thread_pool);
+}
+
+ThreadPool& SearchServer::GetThreadPool() const {
+    return *thread_pool_;
+}
+
+void SearchServer::SetDynamicPruning(bool enabled) {
+    dynamic_pruning_ = enabled;
+}
+
+bool SearchServer::GetDynamicPruning() const {
+    return dynamic_pruning_;
+}
+
 // int SearchServer::GetDocumentId(int index) const {
 //     return document_ids_.at(index);
 // }
 
-set<int>::const_iterator SearchServer::begin() const {
-    return document_ids_.begin();
+DocumentStore::const_iterator SearchServer::begin() const {
+    return documents_.begin();
 }
 
-set<int>::const_iterator SearchServer::end() const {
-    return document_ids_.end();
+DocumentStore::const_iterator SearchServer::end() const {
+    return documents_.end();
+}
+
+void SearchServer::AddDocuments(const vector<NewDocument>& documents) {
+    METRICS_LATENCY("search_server.add_documents"s);
+    set<int> batch_ids;
+    for (const NewDocument& document : documents) {
+        if ((document.document_id < 0)
+            || (documents_.FindOrdinal(document.document_id) != DocumentStore::NO_DOCUMENT)
+            || !batch_ids.insert(document.document_id).second) {
+            throw invalid_argument("Invalid document_id "s + to_string(document.document_id));
+        }
+    }
+    if (documents.empty()) {
+        return;
+    }
+
+    // Postings and term frequencies of a contiguous part of the batch.
+    // Terms get part-local ids, which are mapped to global ones during the merge
+    struct PartialIndex {
+        unordered_map<string_view, uint32_t> local_ids;
+        vector<string_view> words;
+        vector<vector<Posting>> postings;
+        vector<vector<pair<uint32_t, double>>> word_freqs;
+        vector<TermId> term_ids;
+        size_t error_index = numeric_limits<size_t>::max();
+        string error;
+    };
+
+    const Ordinal first_ordinal = static_cast<Ordinal>(documents_.GetOrdinalCount());
+    const size_t part_count = max<size_t>(1, min(GetThreadCount(), documents.size()));
+    auto part_begin = [&documents, part_count](size_t part) {
+        return documents.size() * part / part_count;
+    };
+
+    vector<PartialIndex> partial_indexes(part_count);
+    thread_pool_->ParallelFor(part_count, [&](size_t part) {
+        PartialIndex& index = partial_indexes[part];
+        vector<uint32_t> word_ids;
+        for (size_t i = part_begin(part); i < part_begin(part + 1); ++i) {
+            vector<string_view> words;
+            try {
+                words = SplitIntoWordsNoStop(documents[i].text);
+            } catch (const invalid_argument& e) {
+                // Kept per part, so the first invalid document of the batch is reported
+                index.error_index = i;
+                index.error = e.what();
+                return;
+            }
+            word_ids.clear();
+            for (string_view word : words) {
+                // try_emplace does not allocate a node for words seen before
+                auto [it, inserted] = index.local_ids.try_emplace(word, static_cast<uint32_t>(index.words.size()));
+                if (inserted) {
+                    index.words.push_back(word);
+                    index.postings.emplace_back();
+                }
+                word_ids.push_back(it->second);
+            }
+            // Runs of equal ids give term frequencies without a map per document
+            sort(word_ids.begin(), word_ids.end());
+            const double inv_word_count = 1.0 / words.size();
+            auto& word_freqs = index.word_freqs.emplace_back();
+            for (uint32_t local_id : word_ids) {
+                // Summed like AddDocument does, so both give bit-identical frequencies
+                if (word_freqs.empty() || word_freqs.back().first != local_id) {
+                    word_freqs.push_back({local_id, 0.0});
+                }
+                word_freqs.back().second += inv_word_count;
+            }
+            for (const auto& [local_id, term_freq] : word_freqs) {
+                index.postings[local_id].push_back({first_ordinal + static_cast<Ordinal>(i), term_freq});
+            }
+        }
+    });
+    // Parts are ordered, so the first error found belongs to the earliest invalid document
+    for (const PartialIndex& index : partial_indexes) {
+        if (index.error_index != numeric_limits<size_t>::max()) {
+            throw invalid_argument("Document "s + to_string(documents[index.error_index].document_id)
+                                   + ": "s + index.error);
+        }
+    }
+
+    // Ordinals and term ids are handed out serially, which only costs a lookup per distinct word of a part
+    for (const NewDocument& document : documents) {
+        documents_.Add(document.document_id, ComputeAverageRating(document.ratings), document.status);
+    }
+    struct TermPart {
+        TermId term_id;
+        uint32_t part;
+        uint32_t local_id;
+    };
+    vector<TermPart> term_parts;
+    for (size_t part = 0; part < part_count; ++part) {
+        PartialIndex& index = partial_indexes[part];
+        index.term_ids.reserve(index.words.size());
+        for (string_view word : index.words) {
+            index.term_ids.push_back(terms_.Intern(word));
+            term_parts.push_back({index.term_ids.back(), static_cast<uint32_t>(part),
+                                  static_cast<uint32_t>(index.term_ids.size() - 1)});
+        }
+    }
+    ResizePostings(terms_.size());
+    document_freqs_.resize(terms_.size());
+    max_term_freqs_.resize(terms_.size());
+    idf_by_term_.resize(terms_.size());
+
+    // Grouped by term with parts in order, so appending keeps every posting list sorted
+    sort(term_parts.begin(), term_parts.end(), [](const TermPart& lhs, const TermPart& rhs) {
+        return lhs.term_id != rhs.term_id ? lhs.term_id < rhs.term_id : lhs.part < rhs.part;
+    });
+    vector<size_t> term_begins;
+    for (size_t i = 0; i < term_parts.size(); ++i) {
+        if (i == 0 || term_parts[i].term_id != term_parts[i - 1].term_id) {
+            term_begins.push_back(i);
+        }
+    }
+    term_begins.push_back(term_parts.size());
+    // Every term owns its posting list and counters, so terms are merged in parallel
+    thread_pool_->ParallelFor(term_begins.size() - 1, [&](size_t term_index) {
+        const TermId term_id = term_parts[term_begins[term_index]].term_id;
+        for (size_t i = term_begins[term_index]; i < term_begins[term_index + 1]; ++i) {
+            const vector<Posting>& postings = partial_indexes[term_parts[i].part].postings[term_parts[i].local_id];
+            for (const Posting& posting : postings) {
+                AppendPosting(term_id, posting.ordinal, posting.term_freq);
+                max_term_freqs_[term_id] = max(max_term_freqs_[term_id], posting.term_freq);
+            }
+            document_freqs_[term_id] += static_cast<uint32_t>(postings.size());
+        }
+    });
+
+    word_freqs_by_ordinal_.resize(first_ordinal + documents.size());
+    thread_pool_->ParallelFor(part_count, [&](size_t part) {
+        const PartialIndex& index = partial_indexes[part];
+        const size_t first = part_begin(part);
+        for (size_t i = first; i < part_begin(part + 1); ++i) {
+            auto& term_freqs = word_freqs_by_ordinal_[first_ordinal + i];
+            for (const auto& [local_id, term_freq] : index.word_freqs[i - first]) {
+                term_freqs.push_back({index.term_ids[local_id], term_freq});
+            }
+            sort(term_freqs.begin(), term_freqs.end());
+        }
+    });
+    ++corpus_generation_;
 }
 
 void SearchServer::RemoveDocument(int document_id) {
-    
-    for (const auto& [key, value] : GetWordFrequencies(document_id)) {
-        word_to_document_freqs_.at(key).erase(document_id);
-        if (word_to_document_freqs_.at(key).empty()) {
-            word_to_document_freqs_.erase(key);
+    METRICS_LATENCY("search_server.remove_document"s);
+    const Ordinal ordinal = documents_.Remove(document_id);
+    if (ordinal == DocumentStore::NO_DOCUMENT) {
+        return;
+    }
+    // Postings stay until their terms are compacted, queries skip them by the tombstone
+    auto& term_freqs = word_freqs_by_ordinal_[ordinal];
+    dirty_term_flags_.Resize(terms_.size());
+    for (const auto& [term_id, _] : term_freqs) {
+        --document_freqs_[term_id];
+        if (!dirty_term_flags_.Test(term_id)) {
+            dirty_term_flags_.Set(term_id);
+            dirty_terms_.push_back(term_id);
+        }
+    }
+    const size_t term_count = term_freqs.size();
+    vector<pair<TermId, double>>().swap(term_freqs);
+    ++pending_removal_count_;
+    ++corpus_generation_;
+    if (pending_removal_count_ > compaction_threshold_ * documents_.size()) {
+        // Twice the terms the removal may have made dirty, so the backlog shrinks with every removal
+        // and no single call rewrites the whole index
+        CompactTerms(2 * term_count);
+    }
+}
+
+void SearchServer::Compact() {
+    METRICS_LATENCY("search_server.compact"s);
+    CompactTerms(dirty_terms_.size());
+    if (documents_.size() != documents_.GetOrdinalCount()) {
+        RenumberOrdinals();
+    }
+}
+
+void SearchServer::CompactTerms(size_t term_count) {
+    term_count = min(term_count, dirty_terms_.size());
+    const vector<TermId> term_ids(dirty_terms_.begin(), dirty_terms_.begin() + term_count);
+    dirty_terms_.erase(dirty_terms_.begin(), dirty_terms_.begin() + term_count);
+
+    thread_pool_->ParallelFor(term_ids.size(), [this, &term_ids](size_t index) {
+        const TermId term_id = term_ids[index];
+        auto compact = [this, term_id](auto& postings) {
+            postings.RemoveIf([this](Ordinal ordinal) {
+                return documents_.IsRemoved(ordinal);
+            });
+            document_freqs_[term_id] = static_cast<uint32_t>(postings.size());
+            // Pruning bounds get tighter without the removed documents
+            double max_term_freq = 0.0;
+            for (const Posting& posting : postings) {
+                max_term_freq = max(max_term_freq, posting.term_freq);
+            }
+            max_term_freqs_[term_id] = max_term_freq;
+        };
+        if (posting_format_ == PostingFormat::COMPRESSED) {
+            compact(compressed_postings_[term_id]);
+        } else {
+            compact(word_to_document_freqs_[term_id]);
+        }
+    });
+    for (TermId term_id : term_ids) {
+        dirty_term_flags_.Reset(term_id);
+    }
+    // Recounted frequencies equal the maintained ones, so cached IDF stays valid
+
+    if (dirty_terms_.empty()) {
+        pending_removal_count_ = 0;
+        // Rewriting every list pays off once removed slots outnumber stored ones,
+        // which takes as many removals as there are stored documents
+        if (documents_.GetOrdinalCount() - documents_.size() > documents_.size()) {
+            RenumberOrdinals();
+        }
+    }
+}
+
+void SearchServer::RenumberOrdinals() {
+    METRICS_LATENCY("search_server.renumber_ordinals"s);
+    const Ordinal old_count = static_cast<Ordinal>(documents_.GetOrdinalCount());
+    const vector<Ordinal> new_ordinals = documents_.Renumber();
+
+    // The mapping keeps the order, so posting lists stay sorted
+    if (posting_format_ == PostingFormat::COMPRESSED) {
+        thread_pool_->ParallelFor(compressed_postings_.size(), [this, &new_ordinals](size_t term_id) {
+            compressed_postings_[term_id].Renumber(new_ordinals);
+        });
+    } else {
+        thread_pool_->ParallelFor(word_to_document_freqs_.size(), [this, &new_ordinals](size_t term_id) {
+            word_to_document_freqs_[term_id].Renumber(new_ordinals);
+        });
+    }
+
+    vector<vector<pair<TermId, double>>> word_freqs_by_ordinal;
+    word_freqs_by_ordinal.reserve(documents_.GetOrdinalCount());
+    for (Ordinal ordinal = 0; ordinal < old_count; ++ordinal) {
+        if (new_ordinals[ordinal] != DocumentStore::NO_DOCUMENT) {
+            word_freqs_by_ordinal.push_back(move(word_freqs_by_ordinal_[ordinal]));
+        }
+    }
+    word_freqs_by_ordinal_ = move(word_freqs_by_ordinal);
+
+    // A removed original is as good as none, new documents take its place
+    for (auto it = original_fingerprints_.begin(); it != original_fingerprints_.end();) {
+        if (new_ordinals[it->second] == DocumentStore::NO_DOCUMENT) {
+            it = original_fingerprints_.erase(it);
+        } else {
+            it->second = new_ordinals[it->second];
+            ++it;
         }
     }
-        word_freqs_by_id_.erase(document_id);
-        documents_.erase(document_id);
-        document_ids_.erase(document_id);
+    fingerprinted_ordinal_count_ = static_cast<Ordinal>(
+        count_if(new_ordinals.begin(), new_ordinals.begin() + fingerprinted_ordinal_count_, [](Ordinal ordinal) {
+            return ordinal != DocumentStore::NO_DOCUMENT;
+        }));
+    // Ordinal-keyed caches such as compiled filters are outdated
+    ++corpus_generation_;
+}
+
+void SearchServer::SetCompactionThreshold(double threshold) {
+    compaction_threshold_ = max(threshold, 0.0);
+}
+
+double SearchServer::GetCompactionThreshold() const {
+    return compaction_threshold_;
+}
+
+size_t SearchServer::GetPendingRemovalCount() const {
+    return pending_removal_count_;
+}
+
+void SearchServer::SetPostingFormat(PostingFormat format) {
+    if (format == posting_format_) {
+        return;
+    }
+    if (format == PostingFormat::COMPRESSED) {
+        compressed_postings_.resize(word_to_document_freqs_.size());
+        thread_pool_->ParallelFor(word_to_document_freqs_.size(), [this](size_t term_id) {
+            compressed_postings_[term_id] = CompressedPostingList(word_to_document_freqs_[term_id]);
+        });
+        vector<PostingList>().swap(word_to_document_freqs_);
+    } else {
+        word_to_document_freqs_.resize(compressed_postings_.size());
+        for (size_t term_id = 0; term_id < compressed_postings_.size(); ++term_id) {
+            for (const Posting& posting : compressed_postings_[term_id]) {
+                word_to_document_freqs_[term_id].Add(posting.ordinal, posting.term_freq);
+            }
+        }
+        vector<CompressedPostingList>().swap(compressed_postings_);
+    }
+    posting_format_ = format;
+}
+
+PostingFormat SearchServer::GetPostingFormat() const {
+    return posting_format_;
+}
+
+size_t SearchServer::GetPostingByteSize() const {
+    size_t byte_size = 0;
+    for (const PostingList& postings : word_to_document_freqs_) {
+        byte_size += sizeof(postings) + postings.GetByteSize();
+    }
+    for (const CompressedPostingList& postings : compressed_postings_) {
+        byte_size += sizeof(postings) + postings.GetByteSize();
+    }
+    return byte_size;
+}
+
+vector<DuplicateGroup> SearchServer::FindDuplicates() {
+    struct Candidate {
+        Fingerprint fingerprint;
+        int document_id;
+        Ordinal ordinal;
+    };
+
+    const Ordinal first_ordinal = fingerprinted_ordinal_count_;
+    const Ordinal last_ordinal = static_cast<Ordinal>(documents_.GetOrdinalCount());
+    fingerprinted_ordinal_count_ = last_ordinal;
+
+    vector<Candidate> candidates;
+    for (Ordinal ordinal = first_ordinal; ordinal < last_ordinal; ++ordinal) {
+        if (!documents_.IsRemoved(ordinal)) {
+            candidates.push_back({Fingerprint(), documents_.GetId(ordinal), ordinal});
+        }
+    }
+    // Term lists are sorted by TermId, so equal word sets give equal fingerprints
+    thread_pool_->ParallelFor(candidates.size(), [this, &candidates](size_t index) {
+        Candidate& candidate = candidates[index];
+        FingerprintBuilder builder;
+        for (const auto& [term_id, _] : word_freqs_by_ordinal_[candidate.ordinal]) {
+            builder.Add(term_id);
+        }
+        candidate.fingerprint = builder.Get();
+    });
+    sort(execution::par, candidates.begin(), candidates.end(), [](const Candidate& lhs, const Candidate& rhs) {
+        return lhs.fingerprint == rhs.fingerprint ? lhs.document_id < rhs.document_id
+                                                  : lhs.fingerprint < rhs.fingerprint;
+    });
+
+    vector<DuplicateGroup> groups;
+    for (auto first = candidates.begin(); first != candidates.end();) {
+        auto last = find_if(first, candidates.end(), [first](const Candidate& candidate) {
+            return !(candidate.fingerprint == first->fingerprint);
+        });
+        auto [it, inserted] = original_fingerprints_.emplace(first->fingerprint, first->ordinal);
+        if (!inserted && documents_.IsRemoved(it->second)) {
+            // The original was removed since, the new documents take its place
+            it->second = first->ordinal;
+            inserted = true;
+        }
+        if (inserted) {
+            ++first;
+        }
+        if (first != last) {
+            DuplicateGroup group{documents_.GetId(it->second), {}};
+            for (; first != last; ++first) {
+                group.duplicate_ids.push_back(first->document_id);
+            }
+            groups.push_back(move(group));
+        }
+        first = last;
+    }
+    sort(groups.begin(), groups.end(), [](const DuplicateGroup& lhs, const DuplicateGroup& rhs) {
+        return lhs.original_id < rhs.original_id;
+    });
+    return groups;
+}
+
+double SearchServer::GetInverseDocumentFreq(string_view word) const {
+    const TermId term_id = FindIndexedTerm(word);
+    if (term_id == TermDictionary::NO_TERM) {
+        throw out_of_range("GetInverseDocumentFreq: word is not indexed"s);
+    }
+    return ComputeWordInverseDocumentFreq(term_id);
+}
+
+void SearchServer::SetCorpusStatistics(const CorpusStatistics* statistics) {
+    corpus_statistics_ = statistics;
+    // Generations of different sources are unrelated
+    for (CachedIdf& cached : idf_by_term_) {
+        cached.generation.store(CachedIdf::NO_GENERATION, memory_order_relaxed);
+    }
+    result_cache_.Clear();
+}
+
+uint64_t SearchServer::GetCorpusGeneration() const {
+    return corpus_generation_;
+}
+
+void SearchServer::SetResultCacheCapacity(size_t capacity) {
+    result_cache_.SetCapacity(capacity);
+}
+
+size_t SearchServer::GetResultCacheCapacity() const {
+    return result_cache_.GetCapacity();
+}
+
+QueryCache::Statistics SearchServer::GetResultCacheStatistics() const {
+    return result_cache_.GetStatistics();
+}
+
+uint64_t SearchServer::GetResultGeneration() const {
+    // Both counters only grow, so the sum changes with either of them
+    return corpus_generation_ + (corpus_statistics_ ? corpus_statistics_->GetGeneration() : 0);
+}
+
+SearchServer::CompiledFilter SearchServer::CompileFilter(const DocumentFilter& filter) const {
+    auto [accepted, id] = filter_bitmaps_.Find(filter, corpus_generation_);
+    if (!accepted) {
+        METRICS_LATENCY("search_server.compile_filter"s);
+        auto bitmap = make_shared<Bitmap>(documents_.GetOrdinalCount());
+        auto check = [this, &filter, &bitmap](Ordinal ordinal) {
+            if (!documents_.IsRemoved(ordinal)
+                && filter(documents_.GetId(ordinal), documents_.GetStatus(ordinal), documents_.GetRating(ordinal))) {
+                bitmap->Set(ordinal);
+            }
+        };
+        if (filter.HasAllowedIds()) {
+            // Allow lists are usually short, only their documents are looked at
+            for (int document_id : filter.GetAllowedIds()) {
+                const Ordinal ordinal = documents_.FindOrdinal(document_id);
+                if (ordinal != DocumentStore::NO_DOCUMENT) {
+                    check(ordinal);
+                }
+            }
+        } else {
+            for (Ordinal ordinal = 0; ordinal < documents_.GetOrdinalCount(); ++ordinal) {
+                check(ordinal);
+            }
+        }
+        accepted = move(bitmap);
+        id = filter_bitmaps_.Insert(filter, corpus_generation_, accepted);
+    }
+    return {move(accepted), id};
+}
+
+bool SearchServer::CompareDocuments(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < MAX_DELTA_ERROR) {
+        if (lhs.rating != rhs.rating) {
+            return lhs.rating > rhs.rating;
+        }
+        // Full ties are broken by id, so every evaluation strategy selects the same documents
+        return lhs.id < rhs.id;
+    }
+    return lhs.relevance > rhs.relevance;
 }
 
 bool SearchServer::IsStopWord(string_view word) const {
@@ -70,24 +556,29 @@ bool SearchServer::IsValidWord(string_view word) {
     });
 }
 
-const map<string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    static const map<string_view, double> dummy_;
-    if (word_freqs_by_id_.count(document_id)) {
-        return word_freqs_by_id_.at(document_id);
+map<string_view, double> SearchServer::GetWordFrequencies(int document_id) const {
+    map<string_view, double> word_freqs;
+    const Ordinal ordinal = documents_.FindOrdinal(document_id);
+    if (ordinal != DocumentStore::NO_DOCUMENT) {
+        for (const auto& [term_id, term_freq] : word_freqs_by_ordinal_[ordinal]) {
+            word_freqs.emplace(terms_.GetTerm(term_id), term_freq);
+        }
     }
-    return dummy_;
+    return word_freqs;
 }
 
 vector<string_view> SearchServer::SplitIntoWordsNoStop(string_view text) const {
     vector<string_view> words;
-    for (string_view word : SplitIntoWordsStringView(text)) {
-        if (!IsValidWord(word)) {
-            throw invalid_argument("Word "s + static_cast<string>(word) + " is invalid"s);
-        }
-        if (!IsStopWord(word)) {
-            words.emplace_back(word);
+    if (!SplitIntoValidWords(text, words)) {
+        // Rare path, find the word to report
+        for (string_view word : words) {
+            if (!IsValidWord(word)) {
+                throw invalid_argument("Word "s + static_cast<string>(word) + " is invalid"s);
+            }
         }
     }
+    words.erase(remove_if(words.begin(), words.end(), [this](string_view word) { return IsStopWord(word); }),
+                words.end());
     return words;
 }
 
@@ -100,7 +591,8 @@ int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
     return rating_sum / static_cast<int>(ratings.size());
 }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(string_view word) const {
+// Control characters are rejected by ParseQuery while splitting
+SearchServer::QueryWord SearchServer::ParseQueryWord(string_view word) {
     
     if (word.empty()) {
         throw invalid_argument("Query word is empty"s);
@@ -111,16 +603,61 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(string_view word) const {
         is_minus = true;
         word = word.substr(1);
     }
-    if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
+    if (word.empty() || word[0] == '-') {
         throw invalid_argument("Query word is invalid");
     }
 
-    return {word, is_minus, IsStopWord(word)};
+    return {word, is_minus};
+}
+
+SearchServer::TermId SearchServer::FindIndexedTerm(string_view word) const {
+    const TermId term_id = terms_.Find(word);
+    if (term_id == TermDictionary::NO_TERM || document_freqs_[term_id] == 0) {
+        return TermDictionary::NO_TERM;
+    }
+    return term_id;
+}
+
+void SearchServer::ResizePostings(size_t term_count) {
+    if (posting_format_ == PostingFormat::COMPRESSED) {
+        compressed_postings_.resize(term_count);
+    } else {
+        word_to_document_freqs_.resize(term_count);
+    }
+}
+
+void SearchServer::AppendPosting(TermId term_id, Ordinal ordinal, double term_freq) {
+    if (posting_format_ == PostingFormat::COMPRESSED) {
+        compressed_postings_[term_id].Append(ordinal, term_freq);
+    } else {
+        word_to_document_freqs_[term_id].Add(ordinal, term_freq);
+    }
+}
+
+bool SearchServer::HasPosting(TermId term_id, Ordinal ordinal) const {
+    if (posting_format_ == PostingFormat::COMPRESSED) {
+        return compressed_postings_[term_id].Contains(ordinal);
+    }
+    return word_to_document_freqs_[term_id].Contains(ordinal);
 }
 
     // Existence required
-double SearchServer::ComputeWordInverseDocumentFreq(string_view word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+double SearchServer::ComputeWordInverseDocumentFreq(TermId term_id) const {
+    CachedIdf& cached = idf_by_term_[term_id];
+    if (corpus_statistics_ != nullptr) {
+        const uint64_t generation = corpus_statistics_->GetGeneration();
+        if (cached.generation.load(memory_order_acquire) != generation) {
+            cached.value.store(log(corpus_statistics_->GetDocumentCount() * 1.0
+                                   / corpus_statistics_->GetDocumentFreq(terms_.GetTerm(term_id))),
+                               memory_order_relaxed);
+            cached.generation.store(generation, memory_order_release);
+        }
+    } else if (cached.generation.load(memory_order_acquire) != corpus_generation_) {
+        cached.value.store(log(GetDocumentCount() * 1.0 / document_freqs_[term_id]),
+                           memory_order_relaxed);
+        cached.generation.store(corpus_generation_, memory_order_release);
+    }
+    return cached.value.load(memory_order_relaxed);
 }
 
 void SearchServer::Query::MakeUnique() {
@@ -8,19 +8,65 @@
 #include <stdexcept>
 #include <iostream>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <queue>
 #include <string_view>
+#include <type_traits>
+#include <typeinfo>
+#include <unordered_map>
 #include "document.h"
 #include "string_processing.h"
-#include "concurrent_map.h"
+#include "bitmap.h"
+#include "posting_list.h"
+#include "compressed_posting_list.h"
+#include "document_store.h"
+#include "document_filter.h"
+#include "term_dictionary.h"
+#include "corpus_statistics.h"
+#include "fingerprint.h"
+#include "query_cache.h"
+#include "metrics.h"
+#include "thread_pool.h"
 
 using namespace std;
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 const double MAX_DELTA_ERROR = 1e-6;
-const int THREAD_COUNT = 4;
+const double COMPACTION_THRESHOLD = 0.25;
+
+enum class PostingFormat {
+    FLAT,       // Sorted vectors of postings
+    COMPRESSED, // Bit-packed blocks, several times smaller and slower to scan
+};
+
+struct QueryResult {
+    vector<Document> documents;
+    bool is_partial = false; // The deadline expired, documents are the best of those scored in time
+};
+
+class IndexSnapshot;
+class ShardedSearchServer;
 
 class SearchServer {
 public:
+    using Deadline = chrono::steady_clock::time_point;
+    static constexpr Deadline NO_DEADLINE = Deadline::max();
+
+    struct NewDocument {
+        int document_id;
+        string_view text;
+        DocumentStatus status;
+        vector<int> ratings;
+    };
+
     template <typename StringContainer>
     explicit SearchServer(const StringContainer& stop_words);
     explicit SearchServer(string_view stop_words_text);
@@ -31,6 +77,12 @@ public:
 void AddDocument(int document_id, const CharContainer& document, DocumentStatus status,
                                const vector<int>& ratings);
 
+    // Tokenizes the batch and merges its postings term by term in parallel.
+    // Nothing is added if any document is invalid
+    void AddDocuments(const vector<NewDocument>& documents);
+
+    // A DocumentFilter is checked against a bitmap compiled once per corpus change,
+    // any other predicate is called for every matched document
 template <typename CharContainer, typename DocumentPredicate>
 vector<Document> FindTopDocuments(const CharContainer& raw_query,
                                   DocumentPredicate document_predicate) const;
@@ -64,8 +116,47 @@ vector<Document> FindTopDocuments(std::execution::sequenced_policy policy,
 
     int GetDocumentCount() const;
 
-    set<int>::const_iterator begin() const;
-    set<int>::const_iterator end() const;
+    // Document-at-a-time evaluation that stops at the deadline and returns the best documents
+    // scored so far. Results finished in time are the same as those of FindTopDocuments
+    template <typename CharContainer, typename DocumentPredicate>
+    QueryResult FindTopDocumentsUntil(const CharContainer& raw_query, Deadline deadline,
+                                      DocumentPredicate document_predicate) const;
+    template <typename CharContainer>
+    QueryResult FindTopDocumentsUntil(const CharContainer& raw_query, Deadline deadline,
+                                      DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+    // Runs FindTopDocumentsUntil on the thread pool. The server must outlive the query
+    // and must not change until it is done
+    template <typename DocumentPredicate>
+    future<QueryResult> SubmitQuery(string raw_query, Deadline deadline, DocumentPredicate document_predicate) const;
+    future<QueryResult> SubmitQuery(string raw_query, Deadline deadline = NO_DEADLINE,
+                                    DocumentStatus status = DocumentStatus::ACTUAL) const;
+    // The callback gets the result on a pool thread, exceptions of the query end up in the returned future
+    future<void> SubmitQuery(string raw_query, Deadline deadline, DocumentStatus status,
+                             function<void(QueryResult)> callback) const;
+
+    // Number of documents returned by FindTopDocuments, MAX_RESULT_DOCUMENT_COUNT by default
+    void SetMaxResultDocumentCount(size_t count);
+    size_t GetMaxResultDocumentCount() const;
+
+    // Number of parts a parallel query is split into, zero (the default) makes it the pool's worker count
+    void SetThreadCount(size_t count);
+    size_t GetThreadCount() const;
+
+    // Runs parallel queries and batch updates, copies of the server share it.
+    // ThreadPool::GetDefault() unless another one is set
+    void SetThreadPool(shared_ptr<ThreadPool> thread_pool);
+    ThreadPool& GetThreadPool() const;
+
+    // Sequential queries skip documents that cannot reach the top by MaxScore bounds, on by default.
+    // Queries whose status or DocumentFilter leaves fewer than half of the documents, counting minus words,
+    // and queries with other predicates are scored exhaustively anyway. Results are the same either way
+    void SetDynamicPruning(bool enabled);
+    bool GetDynamicPruning() const;
+
+    // Ids of stored documents in ascending order
+    DocumentStore::const_iterator begin() const;
+    DocumentStore::const_iterator end() const;
 
     template <typename CharContainer>
     tuple<vector<string_view>, DocumentStatus> MatchDocument(const CharContainer& raw_query,
@@ -79,17 +170,58 @@ vector<Document> FindTopDocuments(std::execution::sequenced_policy policy,
                                                              const CharContainer& raw_query,
                                                              int document_id) const;
 
-    const map<string_view, double>& GetWordFrequencies(int document_id) const;
+    map<string_view, double> GetWordFrequencies(int document_id) const;
 
+    // Marks the document removed, its postings are dropped by later compaction steps
     void RemoveDocument(int document_id);
     template<typename ExecPolicy>
     void RemoveDocument(ExecPolicy&& policy, int document_id);
 
+    // Drops every posting of removed documents and renumbers the stored ones, so removed documents
+    // take no memory. Once removed documents exceed the compaction threshold share of stored ones,
+    // every removal compacts a few terms by itself, and ordinals are renumbered when most slots are removed
+    void Compact();
+
+    // COMPACTION_THRESHOLD by default, zero compacts on every removal
+    void SetCompactionThreshold(double threshold);
+    double GetCompactionThreshold() const;
+
+    // Removed documents whose postings may still be in the index
+    size_t GetPendingRemovalCount() const;
+
+    // Checks documents added since the previous call against each other and earlier originals.
+    // Documents with equal word sets form a group, the smallest new id of a group becomes its original
+    vector<DuplicateGroup> FindDuplicates();
+
+    // Converts every posting list, FLAT by default. Queries give the same results in both formats
+    void SetPostingFormat(PostingFormat format);
+    PostingFormat GetPostingFormat() const;
+
+    // Heap memory held by posting lists
+    size_t GetPostingByteSize() const;
+
+    // IDF is computed from the given statistics instead of this index, nullptr restores the local ones.
+    // The statistics must outlive the server and cover its documents
+    void SetCorpusStatistics(const CorpusStatistics* statistics);
+
+    // Cached IDF of an indexed word, throws out_of_range for words without documents
+    double GetInverseDocumentFreq(string_view word) const;
+
+    // Bumped by every AddDocument and RemoveDocument and when ordinals are renumbered
+    uint64_t GetCorpusGeneration() const;
+
+    // Results of status queries and of capture-less predicates are cached by the normalized query,
+    // entries expire with the corpus generation. Zero capacity, the default, disables the cache
+    void SetResultCacheCapacity(size_t capacity);
+    size_t GetResultCacheCapacity() const;
+    QueryCache::Statistics GetResultCacheStatistics() const;
+
 private:
-    struct DocumentData {
-        int rating;
-        DocumentStatus status;
-    };
+    friend class IndexSnapshot;
+    friend class ShardedSearchServer;
+
+    using TermId = TermDictionary::TermId;
+    using Ordinal = DocumentStore::Ordinal;
     
     struct Query {
         vector<string_view> plus_words;
@@ -97,13 +229,53 @@ private:
         
         void MakeUnique(); // Makes query fields sorted and unique just like set;
     };
+
+    // IDF of a term computed for a corpus generation. Readers may refresh it concurrently,
+    // they all store the same value for the same generation.
+    struct CachedIdf {
+        static constexpr uint64_t NO_GENERATION = numeric_limits<uint64_t>::max();
+
+        CachedIdf() = default;
+
+        CachedIdf(const CachedIdf& other)
+            : value(other.value.load(memory_order_relaxed))
+            , generation(other.generation.load(memory_order_relaxed)) {
+        }
+
+        CachedIdf& operator=(const CachedIdf& other) {
+            value.store(other.value.load(memory_order_relaxed), memory_order_relaxed);
+            generation.store(other.generation.load(memory_order_relaxed), memory_order_relaxed);
+            return *this;
+        }
+
+        atomic<double> value = 0.0;
+        atomic<uint64_t> generation = NO_GENERATION;
+    };
     
     const set<string, less<>> stop_words_;
-    map<string_view, map<int, double>> word_to_document_freqs_;
-    map<int, map<string_view, double>> word_freqs_by_id_;
-    map<int, DocumentData> documents_;
-    set<int> document_ids_;
-    set<string, less<>> all_words_;
+    TermDictionary terms_;
+    vector<PostingList> word_to_document_freqs_; // Indexed by TermId, may hold removed documents
+    vector<CompressedPostingList> compressed_postings_; // Replaces the above in the COMPRESSED format
+    PostingFormat posting_format_ = PostingFormat::FLAT;
+    vector<uint32_t> document_freqs_; // Indexed by TermId, stored documents only
+    vector<double> max_term_freqs_; // Indexed by TermId, bounds term frequencies of the postings
+    mutable vector<CachedIdf> idf_by_term_; // Indexed by TermId, recomputed lazily
+    uint64_t corpus_generation_ = 0;
+    const CorpusStatistics* corpus_statistics_ = nullptr;
+    vector<vector<pair<TermId, double>>> word_freqs_by_ordinal_; // Sorted by TermId
+    DocumentStore documents_;
+    size_t max_result_document_count_ = MAX_RESULT_DOCUMENT_COUNT;
+    size_t thread_count_ = 0;
+    shared_ptr<ThreadPool> thread_pool_ = ThreadPool::GetDefault();
+    bool dynamic_pruning_ = true;
+    size_t pending_removal_count_ = 0; // Removed since dirty_terms_ was empty last
+    deque<TermId> dirty_terms_; // May hold postings of removed documents, compacted oldest first
+    Bitmap dirty_term_flags_; // Indexed by TermId, set for terms in dirty_terms_
+    double compaction_threshold_ = COMPACTION_THRESHOLD;
+    unordered_map<Fingerprint, Ordinal, FingerprintHasher> original_fingerprints_;
+    Ordinal fingerprinted_ordinal_count_ = 0; // Ordinals below are checked by FindDuplicates
+    mutable QueryCache result_cache_;
+    mutable FilterBitmapCache filter_bitmaps_;
 
     bool IsStopWord(string_view word) const;
 
@@ -116,24 +288,130 @@ private:
     struct QueryWord {
         string_view data;
         bool is_minus;
-        bool is_stop;
     };
 
-    QueryWord ParseQueryWord(string_view word) const;
+    // Status filter with an identity the result cache can key on
+    struct StatusPredicate {
+        DocumentStatus status;
+
+        bool operator()(int, DocumentStatus document_status, int) const {
+            return document_status == status;
+        }
+    };
+
+    // DocumentFilter resolved to the stored documents it accepts
+    struct CompiledFilter {
+        shared_ptr<const Bitmap> accepted; // Indexed by ordinal
+        uint64_t id; // Of the compilation in filter_bitmaps_
+    };
+
+    // Served from filter_bitmaps_ until the corpus changes
+    CompiledFilter CompileFilter(const DocumentFilter& filter) const;
+
+    // Checks the minus sign syntax and strips the sign
+    static QueryWord ParseQueryWord(string_view word);
 
     template <typename CharContainer>
     Query ParseQuery(const CharContainer& text) const;
+
+    // Shared by every index representation, words matching is_stop_word are skipped
+    template <typename StopWordPredicate>
+    static Query ParseQuery(string_view text, StopWordPredicate is_stop_word);
     
-    // Existence required
-    double ComputeWordInverseDocumentFreq(string_view word) const;
+    // NO_TERM for words without postings
+    TermId FindIndexedTerm(string_view word) const;
+
+    // Calls the visitor with the posting lists of the current format
+    template <typename Visitor>
+    decltype(auto) VisitPostings(Visitor&& visitor) const;
+
+    void ResizePostings(size_t term_count);
+
+    // Drops postings of removed documents from up to term_count dirty terms
+    void CompactTerms(size_t term_count);
+    // Gives stored documents consecutive ordinals, every posting of removed documents must be gone
+    void RenumberOrdinals();
+    // The ordinal must be greater than every ordinal of the term's postings
+    void AppendPosting(TermId term_id, Ordinal ordinal, double term_freq);
+    bool HasPosting(TermId term_id, Ordinal ordinal) const;
+
+    // Existence required. Served from idf_by_term_ until the corpus changes
+    double ComputeWordInverseDocumentFreq(TermId term_id) const;
+
+    // Stored and passing the predicate. Plain status filters and compiled filters are resolved
+    // at compile time to a bitmap test, other predicates are called with the document fields
+    template <typename DocumentPredicate>
+    bool IsAccepted(Ordinal ordinal, const DocumentPredicate& document_predicate) const {
+        if constexpr (is_same_v<DocumentPredicate, StatusPredicate>) {
+            return documents_.HasStatus(ordinal, document_predicate.status);
+        } else if constexpr (is_same_v<DocumentPredicate, CompiledFilter>) {
+            return document_predicate.accepted->Test(ordinal);
+        } else {
+            return !documents_.IsRemoved(ordinal)
+                   && document_predicate(documents_.GetId(ordinal), documents_.GetStatus(ordinal),
+                                         documents_.GetRating(ordinal));
+        }
+    }
+
+    // Changes whenever cached results may become outdated
+    uint64_t GetResultGeneration() const;
+
+    // nullopt for predicates whose results cannot be told apart by type
+    template <typename DocumentPredicate>
+    static optional<string> MakeResultCacheKey(const Query& query, const DocumentPredicate& document_predicate);
+
+    // Serves the query from result_cache_ or runs the search and stores its result
+    template <typename DocumentPredicate, typename Search>
+    vector<Document> FindTopDocumentsCached(const Query& query, const DocumentPredicate& document_predicate,
+                                            Search search) const;
+
+    // Relevance descending, rating descending for equal relevance, then id ascending
+    static bool CompareDocuments(const Document& lhs, const Document& rhs);
+
+    // Leaves only the best max_result_document_count_ documents sorted by CompareDocuments
+    template <typename ExecutionPolicy>
+    void SelectTopDocuments(ExecutionPolicy&& policy, vector<Document>& documents) const;
+
+    // Ordinals the predicate accepts, less the ones holding minus words. Opaque predicates
+    // are not applied here, the ordinals of removed documents stay set for them
+    template <typename DocumentPredicate, typename PostingIndex>
+    Bitmap FindCandidates(const Query& query, const DocumentPredicate& document_predicate,
+                          const PostingIndex& postings_by_term) const;
+
+    // MaxScore pays off when most stored documents are candidates. Otherwise the filter has already
+    // cut most of the exhaustive work, which opaque predicates may do as well
+    template <typename DocumentPredicate>
+    bool IsPruningEffective(const Bitmap& candidates) const;
+
+    // Document-at-a-time MaxScore evaluation of the best max_result_document_count_ documents.
+    // Stops at the deadline and sets is_partial then
+    template <typename DocumentPredicate, typename PostingIndex>
+    vector<Document> FindTopDocumentsPruned(const Query& query,
+                                            DocumentPredicate document_predicate,
+                                            const PostingIndex& postings_by_term,
+                                            const Bitmap& candidates,
+                                            Deadline deadline = NO_DEADLINE,
+                                            bool* is_partial = nullptr) const;
 
     template <typename DocumentPredicate>
     vector<Document> FindAllDocuments(const Query& query,
                                       DocumentPredicate document_predicate) const;
+    template <typename DocumentPredicate, typename PostingIndex>
+    vector<Document> FindAllDocuments(const Query& query,
+                                      DocumentPredicate document_predicate,
+                                      const PostingIndex& postings_by_term,
+                                      const Bitmap& candidates) const;
     template <typename DocumentPredicate>
     vector<Document> FindAllDocuments(std::execution::parallel_policy policy,
                                       const Query& query,
                                       DocumentPredicate document_predicate) const;
+    // Each part keeps only its best max_result_document_count_ documents, so the result
+    // holds every document of the top but not every matched one
+    template <typename DocumentPredicate, typename PostingIndex>
+    vector<Document> FindAllDocuments(std::execution::parallel_policy policy,
+                                      const Query& query,
+                                      DocumentPredicate document_predicate,
+                                      const PostingIndex& postings_by_term) const;
     template <typename DocumentPredicate>
     vector<Document> FindAllDocuments(std::execution::sequenced_policy policy,
                                       const Query& query,
@@ -151,97 +429,387 @@ SearchServer::SearchServer(const StringContainer& stop_words)
     }
 }
 
+template <typename Visitor>
+decltype(auto) SearchServer::VisitPostings(Visitor&& visitor) const {
+    if (posting_format_ == PostingFormat::COMPRESSED) {
+        return visitor(compressed_postings_);
+    }
+    return visitor(word_to_document_freqs_);
+}
+
 template <typename CharContainer, typename DocumentPredicate>
 vector<Document> SearchServer::FindTopDocuments(const CharContainer& raw_query,
                                                 DocumentPredicate document_predicate) const {
+    if constexpr (is_same_v<DocumentPredicate, DocumentFilter>) {
+        return FindTopDocuments(raw_query, CompileFilter(document_predicate));
+    } else {
+        auto query = ParseQuery(raw_query);
+        query.MakeUnique();
 
-    auto query = ParseQuery(raw_query);
-    query.MakeUnique();
+        return FindTopDocumentsCached(query, document_predicate, [&]() {
+            return VisitPostings([&](const auto& postings_by_term) {
+                const Bitmap candidates = FindCandidates(query, document_predicate, postings_by_term);
+                if (IsPruningEffective<DocumentPredicate>(candidates)) {
+                    return FindTopDocumentsPruned(query, document_predicate, postings_by_term, candidates);
+                }
 
-    auto matched_documents = FindAllDocuments(query, document_predicate);
+                auto matched_documents = FindAllDocuments(query, document_predicate, postings_by_term, candidates);
 
-    sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < MAX_DELTA_ERROR) {
-            return lhs.rating > rhs.rating;
-        } else {
-            return lhs.relevance > rhs.relevance;
+                SelectTopDocuments(std::execution::seq, matched_documents);
+
+                return matched_documents;
+            });
+        });
+    }
+}
+
+template <typename DocumentPredicate>
+optional<string> SearchServer::MakeResultCacheKey(const Query& query,
+                                                  const DocumentPredicate& document_predicate) {
+    string predicate_key;
+    if constexpr (is_same_v<DocumentPredicate, StatusPredicate>) {
+        predicate_key = "s"s + to_string(static_cast<int>(document_predicate.status));
+    } else if constexpr (is_same_v<DocumentPredicate, CompiledFilter>) {
+        predicate_key = "f"s + to_string(document_predicate.id);
+    } else if constexpr (is_empty_v<DocumentPredicate>) {
+        // A capture-less lambda has a type of its own and no state
+        predicate_key = "t"s + typeid(DocumentPredicate).name();
+    } else {
+        return nullopt;
+    }
+    // Words cannot hold control characters, so those separate the parts
+    string key;
+    for (string_view word : query.plus_words) {
+        key.append(word).push_back(' ');
+    }
+    key.push_back('\x01');
+    for (string_view word : query.minus_words) {
+        key.append(word).push_back(' ');
+    }
+    key.push_back('\x02');
+    key += predicate_key;
+    return key;
+}
+
+template <typename DocumentPredicate, typename Search>
+vector<Document> SearchServer::FindTopDocumentsCached(const Query& query,
+                                                      const DocumentPredicate& document_predicate,
+                                                      Search search) const {
+    if (!result_cache_.IsEnabled()) {
+        return search();
+    }
+    const optional<string> key = MakeResultCacheKey(query, document_predicate);
+    if (!key) {
+        return search();
+    }
+    const uint64_t generation = GetResultGeneration();
+    if (auto cached_documents = result_cache_.Find(*key, generation)) {
+        return move(*cached_documents);
+    }
+    vector<Document> documents = search();
+    result_cache_.Insert(*key, generation, documents);
+    return documents;
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::SelectTopDocuments(ExecutionPolicy&& policy, vector<Document>& documents) const {
+    METRICS_LATENCY("search_server.sort"s);
+    const size_t top_count = min(documents.size(), max_result_document_count_);
+    // Heap-based partial sort costs O(n log k) instead of sorting every matched document
+    partial_sort(policy, documents.begin(), documents.begin() + top_count, documents.end(),
+                 CompareDocuments);
+    documents.resize(top_count);
+}
+
+template <typename CharContainer, typename DocumentPredicate>
+QueryResult SearchServer::FindTopDocumentsUntil(const CharContainer& raw_query, Deadline deadline,
+                                                DocumentPredicate document_predicate) const {
+    if constexpr (is_same_v<DocumentPredicate, DocumentFilter>) {
+        return FindTopDocumentsUntil(raw_query, deadline, CompileFilter(document_predicate));
+    } else {
+        auto query = ParseQuery(raw_query);
+        query.MakeUnique();
+
+        // Partial results must not be cached, so the cache is consulted here directly
+        const optional<string> key = result_cache_.IsEnabled() ? MakeResultCacheKey(query, document_predicate)
+                                                               : nullopt;
+        const uint64_t generation = GetResultGeneration();
+        if (key) {
+            if (auto cached_documents = result_cache_.Find(*key, generation)) {
+                return {move(*cached_documents), false};
+            }
         }
-    });
 
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+        QueryResult result;
+        // Only the pruned evaluation can stop at the deadline
+        result.documents = VisitPostings([&](const auto& postings_by_term) {
+            return FindTopDocumentsPruned(query, document_predicate, postings_by_term,
+                                          FindCandidates(query, document_predicate, postings_by_term),
+                                          deadline, &result.is_partial);
+        });
+        if (result.is_partial) {
+            METRICS_COUNT("search_server.partial_results"s, 1);
+        } else if (key) {
+            result_cache_.Insert(*key, generation, result.documents);
+        }
+        return result;
     }
-   
-    return matched_documents;
 }
 
+template <typename CharContainer>
+QueryResult SearchServer::FindTopDocumentsUntil(const CharContainer& raw_query, Deadline deadline,
+                                                DocumentStatus status) const {
+    return FindTopDocumentsUntil(raw_query, deadline, StatusPredicate{status});
+}
 
 template <typename DocumentPredicate>
-vector<Document> SearchServer::FindAllDocuments(const Query& query,
-                                                DocumentPredicate document_predicate) const {
+future<QueryResult> SearchServer::SubmitQuery(string raw_query, Deadline deadline,
+                                              DocumentPredicate document_predicate) const {
+    return thread_pool_->Submit([this, raw_query = move(raw_query), deadline, document_predicate]() {
+        return FindTopDocumentsUntil(raw_query, deadline, document_predicate);
+    });
+}
 
-    map<int, double> document_to_relevance;
-    for (string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+template <typename DocumentPredicate, typename PostingIndex>
+Bitmap SearchServer::FindCandidates(const Query& query, const DocumentPredicate& document_predicate,
+                                    const PostingIndex& postings_by_term) const {
+    Bitmap candidates;
+    if constexpr (is_same_v<DocumentPredicate, StatusPredicate>) {
+        candidates = documents_.GetStatusBitmap(document_predicate.status);
+    } else if constexpr (is_same_v<DocumentPredicate, CompiledFilter>) {
+        candidates = *document_predicate.accepted;
+    } else {
+        candidates.Resize(documents_.GetOrdinalCount());
+        candidates.SetAll();
+    }
+    candidates.Resize(documents_.GetOrdinalCount());
+
+    METRICS_LATENCY("search_server.minus_filter"s);
+    for (string_view word : query.minus_words) {
+        const TermId term_id = FindIndexedTerm(word);
+        if (term_id == TermDictionary::NO_TERM) {
             continue;
         }
-        
-        const double inverse_document_freq = SearchServer::ComputeWordInverseDocumentFreq(word);
-        
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+        for (const auto [ordinal, _] : postings_by_term[term_id]) {
+            candidates.Reset(ordinal);
+        }
+    }
+    return candidates;
+}
+
+template <typename DocumentPredicate>
+bool SearchServer::IsPruningEffective(const Bitmap& candidates) const {
+    if constexpr (is_same_v<DocumentPredicate, StatusPredicate> || is_same_v<DocumentPredicate, CompiledFilter>) {
+        return dynamic_pruning_ && candidates.Count() * 2 >= documents_.size();
+    } else {
+        return false;
+    }
+}
+
+template <typename DocumentPredicate, typename PostingIndex>
+vector<Document> SearchServer::FindTopDocumentsPruned(const Query& query,
+                                                      DocumentPredicate document_predicate,
+                                                      const PostingIndex& postings_by_term,
+                                                      const Bitmap& candidates,
+                                                      Deadline deadline,
+                                                      bool* is_partial) const {
+    using PostingListType = typename PostingIndex::value_type;
+    using PostingIterator = typename PostingListType::const_iterator;
+
+    struct TermCursor {
+        const PostingListType* postings;
+        PostingIterator it;
+        PostingIterator end;
+        double inverse_document_freq;
+        double upper_bound; // Of the term's contribution to any relevance
+
+        // Moves to the first posting not less than the ordinal, which never decreases
+        bool SkipTo(Ordinal ordinal) {
+            if (it != end && it->ordinal < ordinal) {
+                it = postings->LowerBound(it, ordinal);
             }
+            return it != end && it->ordinal == ordinal;
         }
+    };
+
+    const size_t top_count = max_result_document_count_;
+    if (top_count == 0) {
+        return {};
     }
 
-    for (string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+    // Cursors follow the query words, which is the order relevances are summed in by FindAllDocuments
+    vector<TermCursor> cursors;
+    for (string_view word : query.plus_words) {
+        const TermId term_id = FindIndexedTerm(word);
+        if (term_id == TermDictionary::NO_TERM) {
             continue;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-            document_to_relevance.erase(document_id);
-        }
+        const PostingListType& postings = postings_by_term[term_id];
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq(term_id);
+        cursors.push_back({&postings, postings.begin(), postings.end(), inverse_document_freq,
+                           max_term_freqs_[term_id] * inverse_document_freq});
+    }
+
+    // MaxScore orders terms by bound. Terms of the prefix whose bounds sum below the threshold
+    // are non-essential: they cannot lift a document into the top alone, so only essential ones propose documents
+    vector<size_t> by_bound(cursors.size());
+    iota(by_bound.begin(), by_bound.end(), 0);
+    sort(by_bound.begin(), by_bound.end(), [&cursors](size_t lhs, size_t rhs) {
+        return cursors[lhs].upper_bound < cursors[rhs].upper_bound;
+    });
+    vector<double> bound_prefix(cursors.size() + 1, 0.0);
+    for (size_t i = 0; i < by_bound.size(); ++i) {
+        bound_prefix[i + 1] = bound_prefix[i] + cursors[by_bound[i]].upper_bound;
     }
 
+    // A document is skipped only if it stays below the kth relevance by more than
+    // CompareDocuments tolerates, so the result equals the exhaustive one
+    priority_queue<double, vector<double>, greater<>> top_relevances;
+    double threshold = -numeric_limits<double>::infinity();
+    size_t first_essential = 0;
     vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
+    size_t pruned_document_count = 0;
+
+    // Reading the clock for every document would cost more than scoring it
+    const size_t deadline_check_interval = 256;
+    size_t visited_count = 0;
+
+    // Scoped, so the selection below is timed as a stage of its own
+    {
+        METRICS_LATENCY("search_server.posting_traversal"s);
+        while (true) {
+            if (deadline != NO_DEADLINE && visited_count++ % deadline_check_interval == 0
+                && chrono::steady_clock::now() >= deadline) {
+                *is_partial = true;
+                break;
+            }
+
+            Ordinal ordinal = DocumentStore::NO_DOCUMENT;
+            for (size_t i = first_essential; i < by_bound.size(); ++i) {
+                const TermCursor& cursor = cursors[by_bound[i]];
+                if (cursor.it != cursor.end) {
+                    ordinal = min(ordinal, cursor.it->ordinal);
+                }
+            }
+            if (ordinal == DocumentStore::NO_DOCUMENT) {
+                break;
+            }
+
+            // Essential cursors jump over non-candidates instead of proposing them one by one
+            if (!candidates.Test(ordinal)) {
+                const size_t next_candidate = candidates.FindNext(ordinal);
+                if (next_candidate == candidates.size()) {
+                    break;
+                }
+                for (size_t i = first_essential; i < by_bound.size(); ++i) {
+                    cursors[by_bound[i]].SkipTo(static_cast<Ordinal>(next_candidate));
+                }
+                continue;
+            }
+
+            // Opaque predicates are checked per proposal
+            bool skipped = !IsAccepted(ordinal, document_predicate);
+            if (!skipped) {
+                double bound = bound_prefix[first_essential];
+                for (size_t i = first_essential; i < by_bound.size(); ++i) {
+                    const TermCursor& cursor = cursors[by_bound[i]];
+                    if (cursor.it != cursor.end && cursor.it->ordinal == ordinal) {
+                        bound += cursor.it->term_freq * cursor.inverse_document_freq;
+                    }
+                }
+                // Non-essential bounds are replaced by actual contributions, largest first
+                for (size_t i = first_essential; i > 0 && bound >= threshold - MAX_DELTA_ERROR; --i) {
+                    TermCursor& cursor = cursors[by_bound[i - 1]];
+                    bound -= cursor.upper_bound;
+                    if (cursor.SkipTo(ordinal)) {
+                        bound += cursor.it->term_freq * cursor.inverse_document_freq;
+                    }
+                }
+                skipped = bound < threshold - MAX_DELTA_ERROR;
+                pruned_document_count += skipped ? 1 : 0;
+            }
+
+            if (!skipped) {
+                double relevance = 0.0;
+                for (TermCursor& cursor : cursors) {
+                    if (cursor.SkipTo(ordinal)) {
+                        relevance += cursor.it->term_freq * cursor.inverse_document_freq;
+                    }
+                }
+                matched_documents.push_back({documents_.GetId(ordinal), relevance, documents_.GetRating(ordinal)});
+                top_relevances.push(relevance);
+                if (top_relevances.size() > top_count) {
+                    top_relevances.pop();
+                }
+                if (top_relevances.size() == top_count) {
+                    threshold = top_relevances.top();
+                    while (first_essential < by_bound.size()
+                           && bound_prefix[first_essential + 1] < threshold - MAX_DELTA_ERROR) {
+                        ++first_essential;
+                    }
+                }
+            }
+
+            for (size_t i = first_essential; i < by_bound.size(); ++i) {
+                TermCursor& cursor = cursors[by_bound[i]];
+                if (cursor.it != cursor.end && cursor.it->ordinal == ordinal) {
+                    ++cursor.it;
+                }
+            }
+        }
     }
-    
+
+    METRICS_COUNT("search_server.pruned_documents"s, pruned_document_count);
+
+    SelectTopDocuments(std::execution::seq, matched_documents);
     return matched_documents;
 }
 
-template<typename ExecPolicy>
-void SearchServer::RemoveDocument(ExecPolicy&& policy, int document_id) {
-    
-    if (word_freqs_by_id_.count(document_id)) {
-        
-        vector<string_view> tmp(word_freqs_by_id_.at(document_id).size());
-        
-        for (const auto i : word_freqs_by_id_[document_id]) {
-            tmp.push_back(i.first);
-        }
+template <typename DocumentPredicate>
+vector<Document> SearchServer::FindAllDocuments(const Query& query,
+                                                DocumentPredicate document_predicate) const {
+    return VisitPostings([&](const auto& postings_by_term) {
+        return FindAllDocuments(query, document_predicate, postings_by_term,
+                                FindCandidates(query, document_predicate, postings_by_term));
+    });
+}
 
-        for_each(policy,
-        tmp.begin(), tmp.end(),
-        [document_id, this ](auto str){ 
-            if (this->word_to_document_freqs_.count(*str)) {
-                this->word_to_document_freqs_[str].erase(document_id);
-            }
-        }); 
+template <typename DocumentPredicate, typename PostingIndex>
+vector<Document> SearchServer::FindAllDocuments(const Query& query,
+                                                DocumentPredicate document_predicate,
+                                                const PostingIndex& postings_by_term,
+                                                const Bitmap& candidates) const {
+    // Minus words are already out of the candidates, so excluded documents never reach the accumulator
+
+    METRICS_LATENCY("search_server.posting_traversal"s);
+    map<Ordinal, double> document_to_relevance;
+    for (string_view word : query.plus_words) {
+        const TermId term_id = FindIndexedTerm(word);
+        if (term_id == TermDictionary::NO_TERM) {
+            continue;
+        }
+        
+        const double inverse_document_freq = SearchServer::ComputeWordInverseDocumentFreq(term_id);
         
-        for (auto i : tmp) {
-            if (word_to_document_freqs_.at(i).empty()) {
-                this->word_to_document_freqs_.erase(i);
+        for (const auto [ordinal, term_freq] : postings_by_term[term_id]) {
+            if (candidates.Test(ordinal) && IsAccepted(ordinal, document_predicate)) {
+                document_to_relevance[ordinal] += term_freq * inverse_document_freq;
             }
         }
-            
-        word_freqs_by_id_.erase(document_id);
-        documents_.erase(document_id);
-        document_ids_.erase(document_id);
     }
+
+    vector<Document> matched_documents;
+    for (const auto [ordinal, relevance] : document_to_relevance) {
+        matched_documents.push_back({documents_.GetId(ordinal), relevance, documents_.GetRating(ordinal)});
+    }
+    
+    return matched_documents;
+}
+
+template<typename ExecPolicy>
+void SearchServer::RemoveDocument(ExecPolicy&&, int document_id) {
+    // Removal only touches the document frequencies, there is nothing to parallelize
+    RemoveDocument(document_id);
 }
 
 template <typename CharContainer>
@@ -250,7 +818,8 @@ void SearchServer::AddDocument(int document_id,
                                DocumentStatus status,
                                const vector<int>& ratings) {
     
-    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+    METRICS_LATENCY("search_server.add_document"s);
+    if ((document_id < 0) || (documents_.FindOrdinal(document_id) != DocumentStore::NO_DOCUMENT)) {
         throw invalid_argument("Invalid document_id"s);
     }
     
@@ -258,22 +827,29 @@ void SearchServer::AddDocument(int document_id,
     
     const double inv_word_count = 1.0 / words.size();
     
+    map<TermId, double> word_freqs;
     for (string_view word : words) {
-        auto i = all_words_.insert(static_cast<string>(word));
-        string_view new_str = *(i.first);
-        word_to_document_freqs_[new_str][document_id] += inv_word_count;
-        word_freqs_by_id_[document_id][new_str] += inv_word_count;
+        word_freqs[terms_.Intern(word)] += inv_word_count;
     }
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
-    document_ids_.insert(document_id);
+    const Ordinal ordinal = documents_.Add(document_id, ComputeAverageRating(ratings), status);
+    ResizePostings(terms_.size());
+    idf_by_term_.resize(terms_.size());
+    document_freqs_.resize(terms_.size());
+    max_term_freqs_.resize(terms_.size());
+    // Each term gets one posting per document, new ordinals make it an append
+    for (const auto [term_id, term_freq] : word_freqs) {
+        AppendPosting(term_id, ordinal, term_freq);
+        ++document_freqs_[term_id];
+        max_term_freqs_[term_id] = max(max_term_freqs_[term_id], term_freq);
+    }
+    word_freqs_by_ordinal_.emplace_back(word_freqs.begin(), word_freqs.end());
+    ++corpus_generation_;
 }
 
 template <typename CharContainer>
 vector<Document> SearchServer::FindTopDocuments(const CharContainer& raw_query,
                                                 DocumentStatus status) const {
-    return FindTopDocuments(raw_query, [status](int, DocumentStatus document_status, int) {
-        return document_status == status;
-    });
+    return FindTopDocuments(raw_query, StatusPredicate{status});
 }
 
 template <typename CharContainer>
@@ -285,7 +861,8 @@ template <typename CharContainer>
 tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const CharContainer& raw_query,
                                                                        int document_id) const {
     
-    if (document_ids_.count(document_id) == 0) {
+    const Ordinal ordinal = documents_.FindOrdinal(document_id);
+    if (ordinal == DocumentStore::NO_DOCUMENT) {
         throw std::out_of_range("MatchDocument: out_of_range");
     }
     
@@ -299,21 +876,23 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const Cha
     query.MakeUnique();
     
     for (string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+        const TermId term_id = FindIndexedTerm(word);
+        if (term_id == TermDictionary::NO_TERM) {
             continue;
         }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            return {vector<string_view>(), documents_.at(document_id).status};
+        if (HasPosting(term_id, ordinal)) {
+            return {vector<string_view>(), documents_.GetStatus(ordinal)};
         }
     }
     
     vector<string_view> matched_words;
     for (string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+        const TermId term_id = FindIndexedTerm(word);
+        if (term_id == TermDictionary::NO_TERM) {
             continue;
         }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.push_back(word);
+        if (HasPosting(term_id, ordinal)) {
+            matched_words.push_back(terms_.GetTerm(term_id));
         }
     }
 
@@ -321,7 +900,7 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const Cha
     auto it = unique(matched_words.begin(), matched_words.end());
     matched_words.resize(distance(matched_words.begin(), it));
     
-    return {matched_words, documents_.at(document_id).status};
+    return {matched_words, documents_.GetStatus(ordinal)};
 }
 
 template <typename CharContainer>
@@ -329,7 +908,8 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(std::exec
                                                                        const CharContainer& raw_query,
                                                                        int document_id) const {
     
-    if (document_ids_.count(document_id) == 0) {
+    const Ordinal ordinal = documents_.FindOrdinal(document_id);
+    if (ordinal == DocumentStore::NO_DOCUMENT) {
         throw std::out_of_range("MatchDocument: out_of_range");
     }
     
@@ -352,38 +932,34 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(std::exec
         if (this->word_to_document_freqs_.count(word) == 0) {
             return 0;
         }
-        if (this->word_to_document_freqs_.at(word).count(document_id) > 0) {
+        if (this->word_to_document_freqs_.at(word).Contains(document_id) > 0) {
             return 1;
         }
         return 0;
     });
     
     if (to_delete != 0) {
-        return {vector<string_view>(), documents_.at(document_id).status};
+        return {vector<string_view>(), documents_.GetStatus(ordinal)};
     }*/
     
     for (string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+        const TermId term_id = FindIndexedTerm(word);
+        if (term_id == TermDictionary::NO_TERM) {
             continue;
         }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            return {vector<string_view>(), documents_.at(document_id).status};
+        if (HasPosting(term_id, ordinal)) {
+            return {vector<string_view>(), documents_.GetStatus(ordinal)};
         }
     }
     
     const string_view null_str = " ";
     vector<string_view> matched_words(query.plus_words.size(), null_str);
 
-    transform(policy,
-    query.plus_words.begin(), query.plus_words.end(), matched_words.begin(),
-    [null_str, document_id, this](auto& word){
-        if (this->word_to_document_freqs_.count(word) == 0) {
-            return null_str;
-        }
-        if (this->word_to_document_freqs_.at(word).count(document_id)) {
-            return word;
+    thread_pool_->ParallelFor(query.plus_words.size(), [&](size_t index) {
+        const TermId term_id = this->FindIndexedTerm(query.plus_words[index]);
+        if (term_id != TermDictionary::NO_TERM && this->HasPosting(term_id, ordinal)) {
+            matched_words[index] = this->terms_.GetTerm(term_id);
         }
-        return null_str;
     });
     
     for (auto i : matched_words) {
@@ -396,12 +972,12 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(std::exec
     auto it = unique(result.begin(), result.end());
     result.resize(distance(result.begin(), it));
     
-    return {result, documents_.at(document_id).status};
+    return {result, documents_.GetStatus(ordinal)};
 
 }
 
 template <typename CharContainer>
-tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::sequenced_policy policy,
+tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::sequenced_policy,
                                                                        const CharContainer& raw_query,
                                                                        int document_id) const {
     return MatchDocument(raw_query, document_id);
@@ -409,11 +985,23 @@ tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(std::exec
 
 template <typename CharContainer>
 SearchServer::Query SearchServer::ParseQuery(const CharContainer& text) const {
+    METRICS_LATENCY("search_server.parse_query"s);
+    return ParseQuery(std::string_view(text), [this](string_view word) { return IsStopWord(word); });
+}
+
+template <typename StopWordPredicate>
+SearchServer::Query SearchServer::ParseQuery(string_view text, StopWordPredicate is_stop_word) {
     
+    // Reused between queries of the same thread
+    thread_local vector<string_view> words;
+    if (!SplitIntoValidWords(text, words)) {
+        throw invalid_argument("Query word is invalid"s);
+    }
+
     Query result;
-    for (string_view word : SplitIntoWordsStringView(std::string_view(text))) {
+    for (string_view word : words) {
         auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
+        if (!is_stop_word(query_word.data)) {
             if (query_word.is_minus) {
                 result.minus_words.push_back(query_word.data);
             } else {
@@ -428,61 +1016,35 @@ template <typename CharContainer, typename DocumentPredicate>
 vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_policy policy,
                                                 const CharContainer& raw_query,
                                                 DocumentPredicate document_predicate) const {
+    if constexpr (is_same_v<DocumentPredicate, DocumentFilter>) {
+        return FindTopDocuments(policy, raw_query, CompileFilter(document_predicate));
+    } else {
+        auto query = ParseQuery(raw_query);
+        query.MakeUnique();
 
-    
-    auto query = ParseQuery(raw_query);
-    query.MakeUnique();
+        return FindTopDocumentsCached(query, document_predicate, [&]() {
+            auto matched_documents = FindAllDocuments(policy, query, document_predicate);
 
-    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
+            // Only the best documents of every part are left to select from
+            SelectTopDocuments(std::execution::seq, matched_documents);
 
-    sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs,
-                                                                const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < MAX_DELTA_ERROR) {
-            return lhs.rating > rhs.rating;
-        } else {
-            return lhs.relevance > rhs.relevance;
-        }
-    });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+            return matched_documents;
+        });
     }
-   
-    return matched_documents;
 }
 
 template <typename CharContainer, typename DocumentPredicate>
-vector<Document> SearchServer::FindTopDocuments(std::execution::sequenced_policy policy,
+vector<Document> SearchServer::FindTopDocuments(std::execution::sequenced_policy,
                                                 const CharContainer& raw_query,
                                                 DocumentPredicate document_predicate) const {
-
-    
-    auto query = ParseQuery(raw_query);
-    query.MakeUnique();
-
-    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
-
-    sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs,
-                                                                const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < MAX_DELTA_ERROR) {
-            return lhs.rating > rhs.rating;
-        } else {
-            return lhs.relevance > rhs.relevance;
-        }
-    });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-    }
-   
-    return matched_documents;
+    return FindTopDocuments(raw_query, document_predicate);
 }
 
 template <typename CharContainer>
 vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_policy policy,
                                                 const CharContainer& raw_query,
                                                 DocumentStatus status) const {
-    return FindTopDocuments(policy, raw_query, [status](int, DocumentStatus document_status, int) {
-        return document_status == status;
-    });
+    return FindTopDocuments(policy, raw_query, StatusPredicate{status});
 }
 
     template <typename CharContainer>
@@ -495,9 +1057,7 @@ template <typename CharContainer>
 vector<Document> SearchServer::FindTopDocuments(std::execution::sequenced_policy policy,
                                                 const CharContainer& raw_query,
                                                 DocumentStatus status) const {
-    return FindTopDocuments(policy, raw_query, [status](int, DocumentStatus document_status, int) {
-        return document_status == status;
-    });
+    return FindTopDocuments(policy, raw_query, StatusPredicate{status});
 }
 
     template <typename CharContainer>
@@ -510,43 +1070,97 @@ template <typename DocumentPredicate>
 vector<Document> SearchServer::FindAllDocuments(std::execution::parallel_policy policy,
                                                 const Query& query,
                                                 DocumentPredicate document_predicate) const {
+    return VisitPostings([&](const auto& postings_by_term) {
+        return FindAllDocuments(policy, query, document_predicate, postings_by_term);
+    });
+}
 
-    ConcurrentMap<int, double> document_to_relevance(THREAD_COUNT); // Argument should be equal to max available threads;
-    
-    for_each(policy, query.plus_words.begin(), query.plus_words.end(), [this, 
-    document_predicate, &document_to_relevance](auto& word){
-        if (this->word_to_document_freqs_.count(word) != 0) {
-            const double inverse_document_freq = SearchServer::ComputeWordInverseDocumentFreq(word);
-        
-            for (const auto [document_id, term_freq] : this->word_to_document_freqs_.at(word)) {
-                const auto& document_data = this->documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                    document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
+template <typename DocumentPredicate, typename PostingIndex>
+vector<Document> SearchServer::FindAllDocuments(std::execution::parallel_policy,
+                                                const Query& query,
+                                                DocumentPredicate document_predicate,
+                                                const PostingIndex& postings_by_term) const {
+    using PostingListType = typename PostingIndex::value_type;
+
+    vector<pair<const PostingListType*, double>> plus_postings;
+    for (string_view word : query.plus_words) {
+        const TermId term_id = FindIndexedTerm(word);
+        if (term_id != TermDictionary::NO_TERM) {
+            plus_postings.push_back({&postings_by_term[term_id], ComputeWordInverseDocumentFreq(term_id)});
+        }
+    }
+    vector<const PostingListType*> minus_postings;
+    for (string_view word : query.minus_words) {
+        const TermId term_id = FindIndexedTerm(word);
+        if (term_id != TermDictionary::NO_TERM) {
+            minus_postings.push_back(&postings_by_term[term_id]);
+        }
+    }
+
+    // Every part owns a range of ordinals and private dense buffers for it, so workers share nothing.
+    // Words are visited in the same order as in the sequential version, so relevances are identical.
+    const size_t ordinal_count = documents_.GetOrdinalCount();
+    const size_t part_count = max<size_t>(1, min(GetThreadCount(), ordinal_count));
+    vector<vector<Document>> part_documents(part_count);
+    const size_t top_count = max_result_document_count_;
+
+    METRICS_LATENCY("search_server.posting_traversal"s);
+    thread_pool_->ParallelFor(part_count, [&](size_t part) {
+        const Ordinal first = static_cast<Ordinal>(ordinal_count * part / part_count);
+        const Ordinal last = static_cast<Ordinal>(ordinal_count * (part + 1) / part_count);
+        vector<double> relevances(last - first, 0.0);
+        vector<char> matched(last - first, 0);
+
+        for (const auto& [postings, inverse_document_freq] : plus_postings) {
+            const auto end = postings->end();
+            for (auto it = postings->LowerBound(first); it != end && it->ordinal < last; ++it) {
+                const Ordinal ordinal = it->ordinal;
+                if (this->IsAccepted(ordinal, document_predicate)) {
+                    relevances[ordinal - first] += it->term_freq * inverse_document_freq;
+                    matched[ordinal - first] = 1;
                 }
             }
         }
-    });
+        // Unlike the sequential map, the dense buffers make late exclusion a plain store per posting,
+        // while excluding first adds a data-dependent branch to the plus loop. It is timed with the traversal
+        for (const PostingListType* postings : minus_postings) {
+            const auto end = postings->end();
+            for (auto it = postings->LowerBound(first); it != end && it->ordinal < last; ++it) {
+                matched[it->ordinal - first] = 0;
+            }
+        }
 
-    for_each(policy, query.minus_words.begin(), query.minus_words.end(), [this, 
-    document_predicate, &document_to_relevance](auto& word){
-        if (this->word_to_document_freqs_.count(word) != 0) {
-            for (const auto [document_id, _] : this->word_to_document_freqs_.at(word)) {
-                document_to_relevance.erase(document_id);
+        // Bounded heap with the worst kept document on top
+        vector<Document>& top_documents = part_documents[part];
+        for (Ordinal ordinal = first; ordinal < last; ++ordinal) {
+            if (!matched[ordinal - first]) {
+                continue;
+            }
+            const Document document{this->documents_.GetId(ordinal), relevances[ordinal - first],
+                                    this->documents_.GetRating(ordinal)};
+            if (top_documents.size() < top_count) {
+                top_documents.push_back(document);
+                push_heap(top_documents.begin(), top_documents.end(), CompareDocuments);
+            } else if (top_count != 0 && CompareDocuments(document, top_documents.front())) {
+                pop_heap(top_documents.begin(), top_documents.end(), CompareDocuments);
+                top_documents.back() = document;
+                push_heap(top_documents.begin(), top_documents.end(), CompareDocuments);
             }
         }
     });
 
     vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance.BuildOrdinaryMap()) {
-        matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
+    for (auto& documents : part_documents) {
+        matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
     }
     
     return matched_documents;
 }
 
 template <typename DocumentPredicate>
-vector<Document> SearchServer::FindAllDocuments(std::execution::sequenced_policy policy,
+vector<Document> SearchServer::FindAllDocuments(std::execution::sequenced_policy,
                                                 const Query& query,
                                                 DocumentPredicate document_predicate) const {
     return FindAllDocuments(query, document_predicate);
 }
+
@@ -0,0 +1,39 @@
+#include "sharded_search_server.h"
+
+using namespace std;
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    SearchServer& shard = shards_[GetShardIndex(document_id)];
+    if (shard.documents_.FindOrdinal(document_id) == DocumentStore::NO_DOCUMENT) {
+        return;
+    }
+    statistics_->RemoveDocument(shard.GetWordFrequencies(document_id));
+    shard.RemoveDocument(document_id);
+}
+
+map<string_view, double> ShardedSearchServer::GetWordFrequencies(int document_id) const {
+    return shards_[GetShardIndex(document_id)].GetWordFrequencies(document_id);
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    return static_cast<int>(statistics_->GetDocumentCount());
+}
+
+void ShardedSearchServer::SetMaxResultDocumentCount(size_t count) {
+    max_result_document_count_ = count;
+    for (SearchServer& shard : shards_) {
+        shard.SetMaxResultDocumentCount(count);
+    }
+}
+
+size_t ShardedSearchServer::GetMaxResultDocumentCount() const {
+    return max_result_document_count_;
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+    return MixBits(static_cast<uint64_t>(static_cast<uint32_t>(document_id))) % shards_.size();
+}
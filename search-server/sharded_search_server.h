@@ -0,0 +1,120 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <vector>
+#include "corpus_statistics.h"
+#include "document.h"
+#include "fingerprint.h"
+#include "search_server.h"
+
+using namespace std;
+
+// Documents are partitioned across SearchServer shards by a hash of their id.
+// Queries run on every shard in parallel and the shard tops are merged. Shards score with
+// the IDF of the whole corpus, so results are the same as those of one unsharded server,
+// tied documents included.
+class ShardedSearchServer {
+public:
+    template <typename StopWords>
+    ShardedSearchServer(const StopWords& stop_words, size_t shard_count);
+
+    template <typename CharContainer>
+    void AddDocument(int document_id, const CharContainer& document, DocumentStatus status,
+                     const vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    template <typename CharContainer, typename DocumentPredicate>
+    vector<Document> FindTopDocuments(const CharContainer& raw_query, DocumentPredicate document_predicate) const;
+    template <typename CharContainer>
+    vector<Document> FindTopDocuments(const CharContainer& raw_query, DocumentStatus status) const;
+    template <typename CharContainer>
+    vector<Document> FindTopDocuments(const CharContainer& raw_query) const;
+
+    // Words point into the owning shard
+    template <typename CharContainer>
+    tuple<vector<string_view>, DocumentStatus> MatchDocument(const CharContainer& raw_query,
+                                                             int document_id) const;
+
+    map<string_view, double> GetWordFrequencies(int document_id) const;
+
+    int GetDocumentCount() const;
+
+    // Applies to every shard and to the merged result
+    void SetMaxResultDocumentCount(size_t count);
+    size_t GetMaxResultDocumentCount() const;
+
+    size_t GetShardCount() const;
+
+private:
+    vector<SearchServer> shards_;
+    // Shared by the shards, the heap keeps its address when the server is moved
+    unique_ptr<CorpusStatistics> statistics_ = make_unique<CorpusStatistics>();
+    size_t max_result_document_count_ = MAX_RESULT_DOCUMENT_COUNT;
+
+    size_t GetShardIndex(int document_id) const;
+};
+
+template <typename StopWords>
+ShardedSearchServer::ShardedSearchServer(const StopWords& stop_words, size_t shard_count) {
+    if (shard_count == 0) {
+        throw invalid_argument("Shard count must be positive"s);
+    }
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.emplace_back(stop_words);
+        shards_.back().SetCorpusStatistics(statistics_.get());
+    }
+}
+
+template <typename CharContainer>
+void ShardedSearchServer::AddDocument(int document_id, const CharContainer& document, DocumentStatus status,
+                                      const vector<int>& ratings) {
+    SearchServer& shard = shards_[GetShardIndex(document_id)];
+    shard.AddDocument(document_id, document, status, ratings);
+    statistics_->AddDocument(shard.GetWordFrequencies(document_id));
+}
+
+template <typename CharContainer, typename DocumentPredicate>
+vector<Document> ShardedSearchServer::FindTopDocuments(const CharContainer& raw_query,
+                                                       DocumentPredicate document_predicate) const {
+    vector<vector<Document>> shard_documents(shards_.size());
+    // Shards share one pool, so the fan-out and the shard queries do not oversubscribe it
+    shards_.front().GetThreadPool().ParallelFor(shards_.size(), [&](size_t index) {
+        shard_documents[index] = shards_[index].FindTopDocuments(raw_query, document_predicate);
+    });
+
+    vector<Document> matched_documents;
+    for (const auto& documents : shard_documents) {
+        matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+    }
+    const size_t top_count = min(matched_documents.size(), max_result_document_count_);
+    // CompareDocuments breaks ties by id, so tied documents of different shards
+    // come in the order one unsharded server returns them
+    partial_sort(matched_documents.begin(), matched_documents.begin() + top_count, matched_documents.end(),
+                 SearchServer::CompareDocuments);
+    matched_documents.resize(top_count);
+    return matched_documents;
+}
+
+template <typename CharContainer>
+vector<Document> ShardedSearchServer::FindTopDocuments(const CharContainer& raw_query,
+                                                       DocumentStatus status) const {
+    return FindTopDocuments(raw_query, SearchServer::StatusPredicate{status});
+}
+
+template <typename CharContainer>
+vector<Document> ShardedSearchServer::FindTopDocuments(const CharContainer& raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename CharContainer>
+tuple<vector<string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(const CharContainer& raw_query,
+                                                                              int document_id) const {
+    return shards_[GetShardIndex(document_id)].MatchDocument(raw_query, document_id);
+}
@@ -1,5 +1,9 @@
 #include <vector>
 #include <string>
+#include <cstdint>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 #include "string_processing.h"
 
 using namespace std;
@@ -80,3 +84,87 @@ vector<string_view> SplitIntoWordsStringView(string_view str) {
     return result;
 }
 
+namespace {
+
+// Word boundaries are the positions where "is space" flips. in_word tells which kind the next flip is
+struct WordSplitter {
+    string_view text;
+    vector<string_view>& words;
+    size_t word_start = 0;
+    bool in_word = false;
+
+    void AddTransition(size_t pos) {
+        if (in_word) {
+            words.push_back(text.substr(word_start, pos - word_start));
+        } else {
+            word_start = pos;
+        }
+        in_word = !in_word;
+    }
+
+    // Bit i of space_mask is set if text[pos + i] is a space
+    void AddChunk(size_t pos, uint32_t space_mask, uint32_t prev_is_space, int width) {
+        uint32_t transitions = space_mask ^ ((space_mask << 1) | prev_is_space);
+        if (width < 32) {
+            transitions &= (1u << width) - 1;
+        }
+        while (transitions != 0) {
+            AddTransition(pos + __builtin_ctz(transitions));
+            transitions &= transitions - 1;
+        }
+    }
+};
+
+bool IsControlChar(char c) {
+    return c >= '\0' && c < ' ';
+}
+
+} // namespace
+
+bool SplitIntoValidWords(string_view text, vector<string_view>& words) {
+    words.clear();
+    WordSplitter splitter{text, words};
+    const char* data = text.data();
+    size_t pos = 0;
+    uint32_t prev_is_space = 1;
+    uint32_t invalid = 0;
+
+#if defined(__AVX2__)
+    const __m256i spaces = _mm256_set1_epi8(' ');
+    const __m256i zeros = _mm256_setzero_si256();
+    for (; pos + 32 <= text.size(); pos += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+        const uint32_t space_mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, spaces)));
+        // Signed compare: control characters are below ' ' and not negative
+        const __m256i control = _mm256_andnot_si256(_mm256_cmpgt_epi8(zeros, chunk), _mm256_cmpgt_epi8(spaces, chunk));
+        invalid |= static_cast<uint32_t>(_mm256_movemask_epi8(control));
+        splitter.AddChunk(pos, space_mask, prev_is_space, 32);
+        prev_is_space = space_mask >> 31;
+    }
+#elif defined(__SSE2__)
+    const __m128i spaces = _mm_set1_epi8(' ');
+    const __m128i zeros = _mm_setzero_si128();
+    for (; pos + 16 <= text.size(); pos += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+        const uint32_t space_mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, spaces)));
+        // Signed compare: control characters are below ' ' and not negative
+        const __m128i control = _mm_andnot_si128(_mm_cmplt_epi8(chunk, zeros), _mm_cmplt_epi8(chunk, spaces));
+        invalid |= static_cast<uint32_t>(_mm_movemask_epi8(control));
+        splitter.AddChunk(pos, space_mask, prev_is_space, 16);
+        prev_is_space = (space_mask >> 15) & 1;
+    }
+#endif
+
+    for (; pos < text.size(); ++pos) {
+        const uint32_t is_space = data[pos] == ' ' ? 1 : 0;
+        invalid |= IsControlChar(data[pos]) ? 1 : 0;
+        if (is_space != prev_is_space) {
+            splitter.AddTransition(pos);
+        }
+        prev_is_space = is_space;
+    }
+    if (splitter.in_word) {
+        splitter.AddTransition(text.size());
+    }
+    return invalid == 0;
+}
@@ -2,6 +2,7 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <string_view>
 
 using namespace std;
 
@@ -13,6 +14,10 @@ vector<string> SplitIntoWords(const char* str);
 
 vector<string_view> SplitIntoWordsStringView(string_view str);
 
+// Single pass over the text: replaces the content of words with views of space separated words
+// and returns false if the text has control characters (0x00-0x1F). Uses AVX2 or SSE2 when available.
+bool SplitIntoValidWords(string_view text, vector<string_view>& words);
+
 template <typename StringContainer>
 set<string, less<>> MakeUniqueNonEmptyStrings(const StringContainer& container) {
     set<string, less<>> non_empty_strings;
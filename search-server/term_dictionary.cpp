@@ -0,0 +1,86 @@
+#include <cstring>
+#include "term_dictionary.h"
+
+using namespace std;
+
+TermDictionary::TermDictionary(const TermDictionary& other) {
+    // Views of other point into its own arena, so terms are interned anew
+    terms_.reserve(other.terms_.size());
+    ids_.reserve(other.ids_.size());
+    for (string_view term : other.terms_) {
+        Intern(term);
+    }
+}
+
+TermDictionary& TermDictionary::operator=(const TermDictionary& other) {
+    if (this != &other) {
+        TermDictionary tmp(other);
+        *this = move(tmp);
+    }
+    return *this;
+}
+
+TermDictionary::TermDictionary(TermDictionary&& other) noexcept {
+    *this = move(other);
+}
+
+TermDictionary& TermDictionary::operator=(TermDictionary&& other) noexcept {
+    if (this != &other) {
+        blocks_ = move(other.blocks_);
+        current_block_ = other.current_block_;
+        block_used_ = other.block_used_;
+        terms_ = move(other.terms_);
+        ids_ = move(other.ids_);
+        // Its arena is gone, the next Intern must start a block of its own
+        other.blocks_.clear();
+        other.current_block_ = nullptr;
+        other.block_used_ = BLOCK_SIZE;
+        other.terms_.clear();
+        other.ids_.clear();
+    }
+    return *this;
+}
+
+TermDictionary::TermId TermDictionary::Intern(string_view term) {
+    auto it = ids_.find(term);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    const TermId id = static_cast<TermId>(terms_.size());
+    string_view stored = Store(term);
+    terms_.push_back(stored);
+    ids_.emplace(stored, id);
+    return id;
+}
+
+TermDictionary::TermId TermDictionary::Find(string_view term) const {
+    auto it = ids_.find(term);
+    return it == ids_.end() ? NO_TERM : it->second;
+}
+
+string_view TermDictionary::GetTerm(TermId id) const {
+    return terms_.at(id);
+}
+
+size_t TermDictionary::size() const {
+    return terms_.size();
+}
+
+string_view TermDictionary::Store(string_view term) {
+    char* data = nullptr;
+    if (term.size() > BLOCK_SIZE) {
+        // Oversized terms get a block of their own, the current block stays open
+        blocks_.emplace_back(new char[term.size()]);
+        data = blocks_.back().get();
+    } else {
+        if (BLOCK_SIZE - block_used_ < term.size()) {
+            blocks_.emplace_back(new char[BLOCK_SIZE]);
+            current_block_ = blocks_.back().get();
+            block_used_ = 0;
+        }
+        data = current_block_ + block_used_;
+        block_used_ += term.size();
+    }
+    memcpy(data, term.data(), term.size());
+    return {data, term.size()};
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// Interns every term once into an arena of contiguous blocks and hands out dense ids.
+// Views returned by GetTerm stay valid for the lifetime of the dictionary.
+class TermDictionary {
+public:
+    using TermId = uint32_t;
+    static constexpr TermId NO_TERM = numeric_limits<TermId>::max();
+
+    TermDictionary() = default;
+    TermDictionary(const TermDictionary& other);
+    TermDictionary& operator=(const TermDictionary& other);
+    // The moved-from dictionary is left empty and usable
+    TermDictionary(TermDictionary&& other) noexcept;
+    TermDictionary& operator=(TermDictionary&& other) noexcept;
+
+    // Returns id of the term, adding it if it is new
+    TermId Intern(string_view term);
+
+    // NO_TERM if the term is unknown
+    TermId Find(string_view term) const;
+
+    string_view GetTerm(TermId id) const;
+
+    size_t size() const;
+
+private:
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    vector<unique_ptr<char[]>> blocks_;
+    char* current_block_ = nullptr;
+    size_t block_used_ = BLOCK_SIZE;
+    vector<string_view> terms_;
+    unordered_map<string_view, TermId> ids_;
+
+    string_view Store(string_view term);
+};
@@ -0,0 +1,112 @@
+#include "thread_pool.h"
+
+using namespace std;
+
+namespace {
+
+// Pool and deque of the worker running on this thread
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_worker_index = 0;
+
+}
+
+ThreadPool::ThreadPool(size_t worker_count) {
+    if (worker_count == 0) {
+        worker_count = max<size_t>(1, thread::hardware_concurrency());
+    }
+    queues_.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; ++i) {
+        queues_.push_back(make_unique<WorkerQueue>());
+    }
+    workers_.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; ++i) {
+        workers_.emplace_back([this, i]() {
+            RunWorker(i);
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard guard(sleep_guard_);
+        stopping_ = true;
+    }
+    wake_up_.notify_all();
+    for (thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::GetWorkerCount() const {
+    return workers_.size();
+}
+
+shared_ptr<ThreadPool> ThreadPool::GetDefault() {
+    static const shared_ptr<ThreadPool> pool = make_shared<ThreadPool>();
+    return pool;
+}
+
+void ThreadPool::Push(Task task) {
+    {
+        // Under the lock a worker cannot miss the wake-up between its check and its wait.
+        // Counted before it is queued, so the count never drops below zero
+        lock_guard guard(sleep_guard_);
+        pending_task_count_.fetch_add(1, memory_order_relaxed);
+    }
+    WorkerQueue& queue = *queues_[GetQueueIndex()];
+    {
+        lock_guard guard(queue.guard);
+        queue.tasks.push_back(move(task));
+    }
+    wake_up_.notify_one();
+}
+
+bool ThreadPool::TryRunTask(size_t queue_index) {
+    Task task;
+    {
+        WorkerQueue& queue = *queues_[queue_index];
+        lock_guard guard(queue.guard);
+        if (!queue.tasks.empty()) {
+            task = move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+    }
+    for (size_t i = 1; !task && i < queues_.size(); ++i) {
+        WorkerQueue& victim = *queues_[(queue_index + i) % queues_.size()];
+        lock_guard guard(victim.guard);
+        if (!victim.tasks.empty()) {
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+    if (!task) {
+        return false;
+    }
+    pending_task_count_.fetch_sub(1, memory_order_relaxed);
+    task();
+    return true;
+}
+
+void ThreadPool::RunWorker(size_t worker_index) {
+    current_pool = this;
+    current_worker_index = worker_index;
+    while (true) {
+        if (TryRunTask(worker_index)) {
+            continue;
+        }
+        unique_lock guard(sleep_guard_);
+        wake_up_.wait(guard, [this]() {
+            return stopping_ || pending_task_count_.load(memory_order_relaxed) != 0;
+        });
+        if (stopping_ && pending_task_count_.load(memory_order_relaxed) == 0) {
+            return;
+        }
+    }
+}
+
+size_t ThreadPool::GetQueueIndex() {
+    if (current_pool == this) {
+        return current_worker_index;
+    }
+    return next_queue_.fetch_add(1, memory_order_relaxed) % queues_.size();
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+// Fixed set of workers with a task deque each. A worker takes its newest task first and steals
+// the oldest ones of other workers when its own deque is empty. Tasks submitted by a worker
+// go to its own deque, so nested parallel work stays on the threads that are already running
+class ThreadPool {
+public:
+    // One worker per hardware thread by default
+    explicit ThreadPool(size_t worker_count = 0);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Runs the tasks left in the deques, then joins the workers
+    ~ThreadPool();
+
+    size_t GetWorkerCount() const;
+
+    template <typename Function>
+    future<invoke_result_t<Function>> Submit(Function function);
+
+    // Calls function(i) for every i below count and returns once all calls are done.
+    // The calling thread takes part instead of blocking, so calls from inside a task neither
+    // deadlock nor add threads. The first exception thrown by a call is rethrown
+    template <typename Function>
+    void ParallelFor(size_t count, Function function);
+
+    // Shared by servers that were not given a pool of their own
+    static shared_ptr<ThreadPool> GetDefault();
+
+private:
+    using Task = function<void()>;
+
+    struct alignas(64) WorkerQueue {
+        mutex guard;
+        deque<Task> tasks;
+    };
+
+    vector<unique_ptr<WorkerQueue>> queues_;
+    vector<thread> workers_;
+    atomic<size_t> pending_task_count_ = 0;
+    atomic<size_t> next_queue_ = 0;
+    mutex sleep_guard_;
+    condition_variable wake_up_;
+    bool stopping_ = false;
+
+    void Push(Task task);
+    // Own deque first, then the other ones
+    bool TryRunTask(size_t queue_index);
+    void RunWorker(size_t worker_index);
+    // Index of the calling worker of this pool, or of a queue to start searching from
+    size_t GetQueueIndex();
+};
+
+template <typename Function>
+future<invoke_result_t<Function>> ThreadPool::Submit(Function function) {
+    auto task = make_shared<packaged_task<invoke_result_t<Function>()>>(move(function));
+    auto result = task->get_future();
+    Push([task]() {
+        (*task)();
+    });
+    return result;
+}
+
+template <typename Function>
+void ThreadPool::ParallelFor(size_t count, Function function) {
+    if (count == 0) {
+        return;
+    }
+    // Workers claim chunks of indexes, several per worker to even out uneven work
+    const size_t helper_count = min(count, workers_.size()) - 1;
+    const size_t chunk_size = max<size_t>(1, count / (workers_.size() * 8));
+
+    struct State {
+        atomic<size_t> next_index = 0;
+        atomic<size_t> finished_helper_count = 0;
+        mutex error_guard;
+        exception_ptr error;
+    } state;
+
+    auto run_chunks = [&state, &function, count, chunk_size]() {
+        while (true) {
+            const size_t first = state.next_index.fetch_add(chunk_size, memory_order_relaxed);
+            if (first >= count) {
+                return;
+            }
+            const size_t last = min(count, first + chunk_size);
+            try {
+                for (size_t i = first; i < last; ++i) {
+                    function(i);
+                }
+            } catch (...) {
+                lock_guard guard(state.error_guard);
+                if (!state.error) {
+                    state.error = current_exception();
+                }
+                // Nothing else is started once a call failed
+                state.next_index.store(count, memory_order_relaxed);
+            }
+        }
+    };
+
+    for (size_t i = 0; i < helper_count; ++i) {
+        Push([&state, run_chunks]() {
+            run_chunks();
+            state.finished_helper_count.fetch_add(1, memory_order_release);
+        });
+    }
+    run_chunks();
+    // Helpers nobody has picked up yet may sit in this thread's own deque, so run tasks while waiting
+    const size_t queue_index = GetQueueIndex();
+    while (state.finished_helper_count.load(memory_order_acquire) != helper_count) {
+        if (!TryRunTask(queue_index)) {
+            this_thread::yield();
+        }
+    }
+    if (state.error) {
+        rethrow_exception(state.error);
+    }
+}
@@ -0,0 +1,96 @@
+#include "versioned_search_server.h"
+#include "metrics.h"
+
+using namespace std;
+
+VersionedSearchServer::Snapshot VersionedSearchServer::GetSnapshot() const {
+    lock_guard guard(snapshot_mutex_);
+    return published_;
+}
+
+void VersionedSearchServer::Apply(const Update& update) {
+    lock_guard guard(writer_mutex_);
+    shared_ptr<Version> next = Recycle();
+    if (!next) {
+        METRICS_COUNT("versioned_search_server.copies"s, 1);
+        next = make_shared<Version>(current_->server);
+    }
+
+    // A throwing update may leave the copy half changed, it is dropped then
+    update(next->server);
+
+    next->number = current_->number + 1;
+    updates_.push_back(update);
+    Publish(move(next));
+    version_.fetch_add(1, memory_order_release);
+}
+
+void VersionedSearchServer::RemoveDocument(int document_id) {
+    Apply([document_id](SearchServer& server) {
+        server.RemoveDocument(document_id);
+    });
+}
+
+uint64_t VersionedSearchServer::GetVersion() const {
+    return version_.load(memory_order_acquire);
+}
+
+void VersionedSearchServer::Publish(shared_ptr<Version> version) {
+    version->released.store(false, memory_order_relaxed);
+    // Snapshots do not own the server, the deleter only reports that the last one is gone.
+    // It holds the version, so snapshots may outlive this object
+    Snapshot snapshot(&version->server, [version](const SearchServer*) {
+        version->released.store(true, memory_order_release);
+    });
+    {
+        lock_guard guard(snapshot_mutex_);
+        published_.swap(snapshot);
+    }
+    // The replaced snapshot is let go of outside the lock
+
+    if (current_) {
+        retired_.push_back(move(current_));
+        if (retired_.size() > MAX_RETIRED_VERSION_COUNT) {
+            retired_.pop_front();
+        }
+    }
+    current_ = move(version);
+    TrimUpdates();
+}
+
+shared_ptr<VersionedSearchServer::Version> VersionedSearchServer::Recycle() {
+    for (size_t index = retired_.size(); index > 0; --index) {
+        // The acquire pairs with the release of the last snapshot, so readers are done with it
+        if (!retired_[index - 1]->released.load(memory_order_acquire)) {
+            continue;
+        }
+        shared_ptr<Version> version = move(retired_[index - 1]);
+        // Older versions would need more updates replayed than this one
+        retired_.erase(retired_.begin(), retired_.begin() + index);
+
+        const size_t missed_count = current_->number - version->number;
+        try {
+            for (size_t i = updates_.size() - missed_count; i < updates_.size(); ++i) {
+                updates_[i](version->server);
+            }
+        } catch (...) {
+            // The version may be half changed, the published one is copied instead
+            version.reset();
+        }
+        if (version) {
+            METRICS_COUNT("versioned_search_server.replays"s, 1);
+        } else {
+            METRICS_COUNT("versioned_search_server.failed_replays"s, 1);
+        }
+        TrimUpdates();
+        return version;
+    }
+    return nullptr;
+}
+
+void VersionedSearchServer::TrimUpdates() {
+    const uint64_t oldest_number = retired_.empty() ? current_->number : retired_.front()->number;
+    while (updates_.size() > current_->number - oldest_number) {
+        updates_.pop_front();
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "document.h"
+#include "search_server.h"
+
+using namespace std;
+
+// Read-copy-update wrapper: readers take immutable SearchServer snapshots that no later
+// change touches, a single writer at a time builds the next version and publishes it.
+// Up to MAX_RETIRED_VERSION_COUNT earlier versions are kept. Once readers let go of one,
+// the writer brings it up to date by replaying the updates it missed instead of copying the whole index.
+// The whole index is copied only when readers hold every kept version or a replay throws
+class VersionedSearchServer {
+public:
+    using Snapshot = shared_ptr<const SearchServer>;
+    using Update = function<void(SearchServer&)>;
+
+    template <typename StopWords>
+    explicit VersionedSearchServer(const StopWords& stop_words);
+
+    // Takes a lock held only to copy the pointer, so it never waits for an update in progress.
+    // The snapshot stays valid and unchanged while it is held
+    Snapshot GetSnapshot() const;
+
+    // Applies the update to a private copy and publishes it as one version. The update may be
+    // applied to another copy later, so it has to give the same result every time.
+    // If it throws, nothing is published
+    void Apply(const Update& update);
+
+    template <typename CharContainer>
+    void AddDocument(int document_id, const CharContainer& document, DocumentStatus status,
+                     const vector<int>& ratings);
+
+    void RemoveDocument(int document_id);
+
+    // Number of published versions, the initial empty index is version 0
+    uint64_t GetVersion() const;
+
+private:
+    // Each kept version is a copy of the index, more of them mean fewer copies while readers hold snapshots
+    static constexpr size_t MAX_RETIRED_VERSION_COUNT = 3;
+
+    struct Version {
+        template <typename... Args>
+        explicit Version(Args&&... args)
+            : server(forward<Args>(args)...) {
+        }
+
+        SearchServer server;
+        uint64_t number = 0;
+        atomic<bool> released = false; // Set once the last snapshot of it is gone
+    };
+
+    mutable mutex snapshot_mutex_; // Guards published_ only
+    Snapshot published_;
+    shared_ptr<Version> current_;
+    deque<shared_ptr<Version>> retired_; // Published before current_, oldest first
+    deque<Update> updates_; // Turn the oldest retired version into current_, one version each
+    mutex writer_mutex_;
+    atomic<uint64_t> version_ = 0;
+
+    void Publish(shared_ptr<Version> version);
+
+    // Newest retired version no snapshot holds, brought up to current_. Older retired versions are dropped.
+    // nullptr if there is none or the replay throws
+    shared_ptr<Version> Recycle();
+
+    // Drops updates the oldest retired version does not need
+    void TrimUpdates();
+};
+
+template <typename StopWords>
+VersionedSearchServer::VersionedSearchServer(const StopWords& stop_words) {
+    Publish(make_shared<Version>(stop_words));
+}
+
+template <typename CharContainer>
+void VersionedSearchServer::AddDocument(int document_id, const CharContainer& document, DocumentStatus status,
+                                        const vector<int>& ratings) {
+    // The update may be replayed after the caller's text is gone
+    Apply([document_id, text = string(static_cast<string_view>(document)), status, ratings](SearchServer& server) {
+        server.AddDocument(document_id, text, status, ratings);
+    });
+}